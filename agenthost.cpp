@@ -0,0 +1,230 @@
+// Agent host: plays games headless for an external controller, speaking
+// the batched protocol in agentproto.h over the controller's stdin and
+// stdout. Many games step in lockstep so one round trip moves all of them.
+//
+//   ./agenthost --batch 64 -- python3 my_agent.py
+//   ./agenthost --sweep                  (times the bundled echo agent)
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "agentproto.h"
+#include "timing.h"
+#include "variants.h"
+
+using namespace std;
+
+// Host settings
+int batch = 16;             // Games per frame
+long totalSteps = 1000000;  // Steps to play across all games (per batch size with --sweep)
+long maxTicks = 10000;      // A game that lasts this long is ended and a new one started
+int difficulty = 5;
+bool wallsEnabled = true;
+int mapWidth = 0;           // 0 = default size
+int mapHeight = 0;
+uint64_t firstSeed = 1;
+
+// The controller process
+int toAgent = -1;
+int fromAgent = -1;
+pid_t agentPid = -1;
+
+// Start the controller with its stdin and stdout on pipes to us
+static bool startAgent(char** command) {
+    int down[2], up[2];
+    if (pipe(down) < 0 || pipe(up) < 0) return false;
+    agentPid = fork();
+    if (agentPid < 0) return false;
+    if (agentPid == 0) {
+        dup2(down[0], 0);
+        dup2(up[1], 1);
+        close(down[0]);
+        close(down[1]);
+        close(up[0]);
+        close(up[1]);
+        execvp(command[0], command);
+        perror(command[0]);
+        _exit(127);
+    }
+    close(down[0]);
+    close(up[1]);
+    toAgent = down[1];
+    fromAgent = up[0];
+    return true;
+}
+
+// Tell the controller to exit and wait for it
+static void stopAgent() {
+    AgentFrameHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKA", 4);
+    header.version = AGENT_PROTOCOL_VERSION;
+    writeFull(toAgent, &header, sizeof(header));
+    close(toAgent);
+    close(fromAgent);
+    waitpid(agentPid, NULL, 0);
+}
+
+// Play totalSteps steps in rounds of `slots` games. Returns false if the
+// controller stopped answering.
+template <class Engine>
+bool playBatch(int slots) {
+    vector<Engine> games(slots);
+    vector<long> gameTicks(slots, 0);
+    vector<int> newGame(slots, 1);
+    uint64_t nextSeed = firstSeed;
+    for (int i = 0; i < slots; ++i) {
+        if (mapWidth > 0) games[i].resize(mapWidth, mapHeight);
+        games[i].difficulty = difficulty;
+        games[i].wallsEnabled = wallsEnabled;
+        games[i].seed(nextSeed++);
+        games[i].initMap();
+        games[i].running = true;
+    }
+
+    // One buffer for the whole frame, filled in place every round
+    const Engine& first = games[0];
+    size_t cellBytes = first.mapSize * sizeof(int32_t);
+    size_t observationSize = sizeof(AgentObservation) + cellBytes;
+    vector<char> frame(sizeof(AgentFrameHeader) + slots * observationSize);
+    vector<char> actions(slots);
+    AgentFrameHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKA", 4);
+    header.version = AGENT_PROTOCOL_VERSION;
+    header.count = slots;
+    header.width = first.mapWidth;
+    header.height = first.mapHeight;
+    memcpy(&frame[0], &header, sizeof(header));
+
+    long steps = 0, rounds = 0, finished = 0, finishedScore = 0;
+    struct timespec start = monotonicNow();
+    while (steps < totalSteps) {
+        // Observations out
+        for (int i = 0; i < slots; ++i) {
+            const Engine& game = games[i];
+            AgentObservation observation;
+            observation.game = i;
+            observation.headx = game.headxpos;
+            observation.heady = game.headypos;
+            observation.direction = game.direction;
+            observation.food = game.food;
+            observation.score = game.score;
+            observation.newGame = newGame[i];
+            observation.reserved = 0;
+            char* out = &frame[sizeof(header) + i * observationSize];
+            memcpy(out, &observation, sizeof(observation));
+            memcpy(out + sizeof(observation), &game.map[0], cellBytes);
+        }
+        if (!writeFull(toAgent, &frame[0], frame.size()) ||
+            !readFull(fromAgent, &actions[0], slots)) {
+            return false;
+        }
+        ++rounds;
+
+        // Actions in, then one tick of every game
+        for (int i = 0; i < slots; ++i) {
+            Engine& game = games[i];
+            game.changeDirection(actions[i]);
+            game.update();
+            ++gameTicks[i];
+            newGame[i] = 0;
+            if (!game.running || gameTicks[i] >= maxTicks) {
+                ++finished;
+                finishedScore += game.score;
+                game.seed(nextSeed++);
+                game.initMap();
+                game.running = true;
+                gameTicks[i] = 0;
+                newGame[i] = 1;
+            }
+        }
+        steps += slots;
+    }
+    double seconds = secondsSince(start);
+    printf("batch %4d: %9ld steps %7ld rounds %7.3f s %11.0f steps/s %8.1f us/round %6ld games",
+           slots, steps, rounds, seconds, steps / seconds, seconds * 1e6 / rounds, finished);
+    if (finished > 0) printf(" %8.1f avg score", (double)finishedScore / finished);
+    printf("\n");
+    return true;
+}
+
+// Play one batch size, or the whole sweep, under one rule set
+template <class Engine>
+bool runHost(bool sweep) {
+    if (!sweep) return playBatch<Engine>(batch);
+    const int sizes[] = {1, 4, 16, 64, 256, 1024};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        if (!playBatch<Engine>(sizes[s])) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rules = "snake6";
+    bool sweep = false;
+    char* echoCommand[] = {const_cast<char*>("./echoagent"), NULL};
+    char** command = echoCommand;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (strcmp(argv[i], "--") == 0 && i + 1 < argc) {
+            command = &argv[i + 1];
+            break;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+            ok = batch >= 1;
+        } else if (strcmp(argv[i], "--sweep") == 0) {
+            sweep = true;
+        } else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            totalSteps = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules = argv[++i];
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && i + 1 < argc) {
+            wallsEnabled = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            ok = sscanf(argv[++i], "%dx%d", &mapWidth, &mapHeight) == 2 && mapWidth >= 3 && mapHeight >= 3;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            firstSeed = strtoull(argv[++i], NULL, 10);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Usage: %s [--batch N | --sweep] [--steps N] [--ticks N] [--rules snake|snake2..snake7]\n"
+                        "       [--difficulty 1-9] [--walls y|n] [--size WxH] [--seed N] [-- COMMAND ARGS...]\n", argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN); // A controller that quits shows up as a failed write
+    if (!startAgent(command)) {
+        perror("agent");
+        return 1;
+    }
+    bool played;
+    if (strcmp(rules, "snake") == 0) played = runHost<SnakeEngine>(sweep);
+    else if (strcmp(rules, "snake2") == 0) played = runHost<Snake2Engine>(sweep);
+    else if (strcmp(rules, "snake3") == 0) played = runHost<Snake3Engine>(sweep);
+    else if (strcmp(rules, "snake4") == 0) played = runHost<Snake4Engine>(sweep);
+    else if (strcmp(rules, "snake5") == 0) played = runHost<Snake5Engine>(sweep);
+    else if (strcmp(rules, "snake6") == 0) played = runHost<Snake6Engine>(sweep);
+    else if (strcmp(rules, "snake7") == 0) played = runHost<Snake7Engine>(sweep);
+    else {
+        fprintf(stderr, "Unknown rules: %s\n", rules);
+        stopAgent();
+        return 1;
+    }
+    if (!played) {
+        fprintf(stderr, "The agent stopped answering\n");
+    }
+    stopAgent();
+    return played ? 0 : 1;
+}
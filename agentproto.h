@@ -0,0 +1,46 @@
+#ifndef AGENTPROTO_H
+#define AGENTPROTO_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Batched agent protocol, spoken over a pair of pipes (native byte order).
+// Each round the game host writes one frame to the agent's stdin:
+//
+//   AgentFrameHeader
+//   count times: AgentObservation, then width * height int32 tiles
+//
+// and reads back count action bytes from the agent's stdout, one per
+// observation in order: 'w', 'a', 's' or 'd' to turn, anything else to go
+// straight. A frame with count 0 tells the agent to exit.
+//
+// Tiles use the game's values (see game.h or snakebot.h).
+
+struct AgentFrameHeader {
+    char magic[4];        // "SNKA"
+    uint32_t version;
+    uint32_t count;       // Observations in this frame
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+};
+
+struct AgentObservation {
+    int32_t game;         // Which game slot this is; stays the same across rounds
+    int32_t headx;
+    int32_t heady;
+    int32_t direction;    // 0 up, 1 right, 2 down, 3 left
+    int32_t food;         // Snake length
+    int32_t score;
+    int32_t newGame;      // 1 if the slot's previous game ended and this one just started
+    int32_t reserved;
+};
+
+const uint32_t AGENT_PROTOCOL_VERSION = 1;
+
+// Read or write exactly size bytes, retrying short transfers.
+// Return false on end of file or an error.
+bool readFull(int fd, void* buffer, size_t size);
+bool writeFull(int fd, const void* buffer, size_t size);
+
+#endif
@@ -0,0 +1,206 @@
+#include "ansiframe.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Number of decimal digits in n
+static int digits(int n) {
+    int d = 1;
+    while (n >= 10) {
+        n /= 10;
+        ++d;
+    }
+    return d;
+}
+
+// Append a decimal number to the buffer
+static void appendNumber(std::string& out, int n) {
+    char buf[16];
+    int len = snprintf(buf, sizeof(buf), "%d", n);
+    out.append(buf, len);
+}
+
+AnsiFrame::AnsiFrame()
+    : width(0), height(0), originRow(1), useRepeat(true), havePrevious(false),
+      colourCount(0), cursorColour(0), cursorRow(-1), cursorCol(-1) {
+}
+
+void AnsiFrame::reset(int w, int h, int row) {
+    width = w;
+    height = h;
+    originRow = row;
+    previous.assign(width * height, ' ');
+    current.assign(width * height, ' ');
+    previousColours.assign(width * height, 0);
+    currentColours.assign(width * height, 0);
+    out.reserve(width * height * 4 + 64);
+    havePrevious = false;
+}
+
+void AnsiFrame::invalidate() {
+    havePrevious = false;
+}
+
+void AnsiFrame::setUseRepeat(bool enabled) {
+    useRepeat = enabled;
+}
+
+void AnsiFrame::setPalette(const std::vector<std::string>& sequences, int count) {
+    transitions = sequences;
+    colourCount = count;
+}
+
+void AnsiFrame::setGlyphs(const std::vector<std::string>& table) {
+    wideGlyphs = table;
+}
+
+int AnsiFrame::glyphSize(char glyph) const {
+    unsigned char code = glyph;
+    if (code >= 0x80 && (size_t)(code - 0x80) < wideGlyphs.size()) return wideGlyphs[code - 0x80].size();
+    return 1;
+}
+
+void AnsiFrame::appendGlyph(char glyph) {
+    unsigned char code = glyph;
+    if (code >= 0x80 && (size_t)(code - 0x80) < wideGlyphs.size()) {
+        out += wideGlyphs[code - 0x80];
+    } else {
+        out += glyph;
+    }
+}
+
+// Switch the terminal to a colour, if it isn't drawing in it already
+void AnsiFrame::setColour(int colour) {
+    if (colour == cursorColour) return;
+    out += transitions[cursorColour * colourCount + colour];
+    cursorColour = colour;
+}
+
+// Move the cursor to a terminal row and grid column using the shortest sequence
+void AnsiFrame::moveTo(int row, int col) {
+    if (cursorRow == row && cursorCol == col) return;
+
+    // Absolute move: ESC [ row ; col H
+    int absoluteCost = 4 + digits(row) + digits(col + 1);
+
+    // Forward on the same row: ESC [ n C
+    if (cursorRow == row && col > cursorCol) {
+        int n = col - cursorCol;
+        if (3 + digits(n) <= absoluteCost) {
+            out += "\x1b[";
+            appendNumber(out, n);
+            out += 'C';
+            cursorCol = col;
+            return;
+        }
+    }
+
+    // Start of the next row: CR LF, then forward if needed
+    if (cursorRow >= 0 && cursorRow == row - 1) {
+        int newlineCost = 2 + (col > 0 ? 3 + digits(col) : 0);
+        if (newlineCost < absoluteCost) {
+            out += "\r\n";
+            if (col > 0) {
+                out += "\x1b[";
+                appendNumber(out, col);
+                out += 'C';
+            }
+            cursorRow = row;
+            cursorCol = col;
+            return;
+        }
+    }
+
+    out += "\x1b[";
+    appendNumber(out, row);
+    out += ';';
+    appendNumber(out, col + 1);
+    out += 'H';
+    cursorRow = row;
+    cursorCol = col;
+}
+
+const std::string& AnsiFrame::encode(const char* glyphs, const unsigned char* colours) {
+    out.clear();
+    cursorRow = -1; // Whatever was written before us may have moved the cursor
+    cursorCol = -1;
+    memcpy(&current[0], glyphs, width * height);
+    if (colours != NULL && colourCount > 0) {
+        memcpy(&currentColours[0], colours, width * height);
+    } else {
+        memset(&currentColours[0], 0, width * height);
+    }
+    cursorColour = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const char* row = glyphs + y * width;
+        const char* old = &previous[y * width];
+        const unsigned char* rowColours = &currentColours[y * width];
+        const unsigned char* oldColours = &previousColours[y * width];
+        int termRow = originRow + y;
+        if (havePrevious && memcmp(row, old, width) == 0 && memcmp(rowColours, oldColours, width) == 0) {
+            continue; // Nothing on this row changed
+        }
+        int x = 0;
+        while (x < width) {
+            if (havePrevious && row[x] == old[x] && rowColours[x] == oldColours[x]) {
+                ++x;
+                continue;
+            }
+
+            // Reach the changed cell. Rewriting a short unchanged gap is
+            // cheaper than any cursor movement sequence, if it's all in the
+            // colour the terminal is drawing in.
+            bool gapInColour = cursorRow == termRow && cursorCol < x && x - cursorCol <= 3;
+            for (int i = cursorCol; gapInColour && i < x; ++i) {
+                gapInColour = rowColours[i] == cursorColour;
+            }
+            if (gapInColour) {
+                for (int i = cursorCol; i < x; ++i) {
+                    appendGlyph(row[i]);
+                }
+                cursorCol = x;
+            } else {
+                moveTo(termRow, x);
+            }
+
+            // Find the run of identical glyphs in one colour that ends on a changed cell
+            char glyph = row[x];
+            int colour = rowColours[x];
+            int run = 1;
+            if (useRepeat) {
+                for (int i = x + 1; i < width && row[i] == glyph && rowColours[i] == colour; ++i) {
+                    if (!havePrevious || row[i] != old[i] || rowColours[i] != oldColours[i]) run = i - x + 1;
+                }
+            }
+
+            setColour(colour);
+            appendGlyph(glyph);
+            if (run > 1) {
+                // ESC [ n b repeats the last glyph n more times
+                if (4 + digits(run - 1) < (run - 1) * glyphSize(glyph) + 1) {
+                    out += "\x1b[";
+                    appendNumber(out, run - 1);
+                    out += 'b';
+                } else {
+                    for (int i = 1; i < run; ++i) {
+                        appendGlyph(glyph);
+                    }
+                }
+            }
+
+            x += run;
+            cursorCol = x;
+            cursorRow = termRow;
+            if (cursorCol >= width) cursorRow = -1; // Might be pending a wrap
+        }
+    }
+    setColour(0); // Leave the terminal as other output expects it
+    return out;
+}
+
+void AnsiFrame::commit() {
+    previous.swap(current);
+    previousColours.swap(currentColours);
+    havePrevious = true;
+}
@@ -0,0 +1,66 @@
+#ifndef ANSIFRAME_H
+#define ANSIFRAME_H
+
+#include <string>
+#include <vector>
+
+// Encodes a grid of glyphs as ANSI escape sequences, sending only the cells
+// that changed since the last committed frame.
+class AnsiFrame {
+public:
+    AnsiFrame();
+
+    // Set the grid size and the terminal row (1-based) of its top line.
+    // Forces the next frame to be drawn in full.
+    void reset(int width, int height, int originRow);
+
+    // Forget the previous frame so the next one is drawn in full
+    void invalidate();
+
+    // Use the REP sequence (ESC [ n b) to repeat runs of the same glyph
+    void setUseRepeat(bool enabled);
+
+    // Colour cells with these SGR sequences: transitions[from * count + to]
+    // switches the terminal from colour `from` to colour `to` (empty when
+    // they're the same). Colour 0 must be the terminal's default.
+    void setPalette(const std::vector<std::string>& transitions, int count);
+
+    // Send glyph codes 0x80 and up as these strings (UTF-8 say) instead of
+    // the byte itself. Each must still take up one column.
+    void setGlyphs(const std::vector<std::string>& table);
+
+    // Encode one glyph per cell into the internal buffer and return it, with
+    // one colour per cell if colours isn't NULL. A colour is sent once per
+    // run of cells that share it, and the frame ends in colour 0.
+    // The buffer is reused between frames, so it stays valid until the next call.
+    const std::string& encode(const char* glyphs, const unsigned char* colours = NULL);
+
+    // Make the last encoded frame the base for the next diff.
+    // Skip this if the frame was never sent.
+    void commit();
+
+private:
+    void moveTo(int row, int col);
+    void setColour(int colour);
+    void appendGlyph(char glyph);
+    int glyphSize(char glyph) const;
+
+    int width;
+    int height;
+    int originRow;
+    bool useRepeat;
+    bool havePrevious;        // Whether previous holds a frame the terminal shows
+    std::vector<char> previous; // Glyphs the terminal currently shows
+    std::vector<char> current;  // Glyphs of the last encoded frame
+    std::vector<unsigned char> previousColours; // Colours matching previous and current
+    std::vector<unsigned char> currentColours;
+    std::vector<std::string> transitions; // SGR sequence from one colour to another
+    std::vector<std::string> wideGlyphs;  // What glyph codes 0x80 and up stand for
+    int colourCount;
+    int cursorColour;         // Colour the terminal draws in after out
+    std::string out;          // Reused output buffer
+    int cursorRow;            // Where the terminal cursor is after out (-1 = unknown)
+    int cursorCol;
+};
+
+#endif
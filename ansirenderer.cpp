@@ -0,0 +1,234 @@
+#include "renderer.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <termios.h>
+#include <unistd.h>
+
+// Terminal settings to put back on exit, shared with the signal handler
+static struct termios savedTermios;
+static volatile sig_atomic_t rawModeActive = 0;
+
+// Show the cursor and leave the alternate screen
+static const char LEAVE_SEQUENCE[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+
+// Restore the terminal if the game is killed while in raw mode
+static void restoreOnSignal(int sig) {
+    if (rawModeActive) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedTermios);
+        ssize_t ignored = write(STDOUT_FILENO, LEAVE_SEQUENCE, sizeof(LEAVE_SEQUENCE) - 1);
+        (void)ignored;
+        rawModeActive = 0;
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+AnsiRenderer::AnsiRenderer(int fd)
+    : width(0), height(0), havePalette(false), active(false), outputFd(fd), bytesOut(0), lastScore(-1) {
+}
+
+bool AnsiRenderer::init() {
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) return false;
+    if (tcgetattr(STDIN_FILENO, &savedTermios) < 0) return false;
+
+    // Raw input and output, but keep Ctrl-C working
+    struct termios raw = savedTermios;
+    raw.c_iflag &= ~(IXON | ICRNL | INLCR | IGNCR);
+    raw.c_oflag &= ~OPOST;
+    raw.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+    raw.c_cc[VMIN] = 0;  // read() returns at once, with or without a key
+    raw.c_cc[VTIME] = 0;
+
+    signal(SIGINT, restoreOnSignal);
+    signal(SIGTERM, restoreOnSignal);
+    signal(SIGHUP, restoreOnSignal);
+    rawModeActive = 1;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) < 0) {
+        rawModeActive = 0;
+        return false;
+    }
+
+    active = true;
+    const char enter[] = "\x1b[?1049h\x1b[?25l\x1b[H\x1b[2J"; // Alternate screen, hide cursor, clear
+    writeAll(enter, sizeof(enter) - 1);
+    return true;
+}
+
+void AnsiRenderer::shutdown() {
+    if (!active) return;
+    writeAll(LEAVE_SEQUENCE, sizeof(LEAVE_SEQUENCE) - 1);
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedTermios);
+    rawModeActive = 0;
+    active = false;
+}
+
+int AnsiRenderer::readKey() {
+    unsigned char c;
+    if (read(STDIN_FILENO, &c, 1) == 1) return c;
+    return -1;
+}
+
+void AnsiRenderer::showMessage(const char* text) {
+    std::string out = "\x1b[H\x1b[2J";
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '\n') out += '\r'; // No output processing in raw mode
+        out += *c;
+    }
+    out += "\r\n";
+    writeAll(out.data(), out.size());
+    frame.invalidate(); // The board is gone from the screen
+    lastScore = -1;
+    boardLost();
+}
+
+void AnsiRenderer::drawStatus(int row, const char* text) {
+    char move[32];
+    int len = snprintf(move, sizeof(move), "\x1b[%d;1H", row + 1);
+    std::string out(move, len);
+    out += text;
+    out += "\x1b[K";
+    writeAll(out.data(), out.size());
+}
+
+// SGR parameter for a foreground or background colour
+static void appendColour(std::string& out, int colour, bool background, bool has256) {
+    char buf[16];
+    if (colour < 0) {
+        out += background ? "49" : "39";
+    } else if (has256) {
+        out.append(buf, snprintf(buf, sizeof(buf), background ? "48;5;%d" : "38;5;%d", colour));
+    } else {
+        int base = colour < 8 ? (background ? 40 : 30) : (background ? 100 : 90);
+        out.append(buf, snprintf(buf, sizeof(buf), "%d", base + colour % 8));
+    }
+}
+
+// Append a parameter to an SGR parameter list
+static void appendParam(std::string& params, const char* param) {
+    if (!params.empty()) params += ';';
+    params += param;
+}
+
+std::string AnsiRenderer::sgrTransition(const TextStyle& a, const TextStyle& b, bool has256) {
+    // Change only what differs...
+    std::string params;
+    if (a.intensity != b.intensity) {
+        if (a.intensity != 0) appendParam(params, "22"); // Bold and dim share one reset
+        if (b.intensity != 0) appendParam(params, b.intensity == 1 ? "1" : "2");
+    }
+    if (a.fg != b.fg) {
+        if (!params.empty()) params += ';';
+        appendColour(params, b.fg, false, has256);
+    }
+    if (a.bg != b.bg) {
+        if (!params.empty()) params += ';';
+        appendColour(params, b.bg, true, has256);
+    }
+    if (params.empty()) return params; // They look the same
+
+    // ...or start from a reset, when that's shorter ("\x1b[m" alone to go plain)
+    std::string reset;
+    if (b.intensity != 0) appendParam(reset, b.intensity == 1 ? "1" : "2");
+    if (b.fg >= 0) {
+        if (!reset.empty()) reset += ';';
+        appendColour(reset, b.fg, false, has256);
+    }
+    if (b.bg >= 0) {
+        if (!reset.empty()) reset += ';';
+        appendColour(reset, b.bg, true, has256);
+    }
+    if (reset.size() + (reset.empty() ? 0 : 2) < params.size()) {
+        params = reset.empty() ? "" : "0;" + reset;
+    }
+    return "\x1b[" + params + "m";
+}
+
+bool AnsiRenderer::terminalHas256Colours() {
+    const char* term = getenv("TERM");
+    return term != NULL && strstr(term, "256color") != NULL;
+}
+
+// Work out the shortest SGR sequence between every pair of colours once,
+// so a frame only ever appends a ready-made string per colour change
+void AnsiRenderer::buildPalette() {
+    bool has256 = terminalHas256Colours();
+    TextStyle styles[COLOUR_COUNT];
+    for (int c = 0; c < COLOUR_COUNT; ++c) {
+        const ColourStyle& style = colourStyle(c);
+        styles[c].intensity = style.intensity;
+        styles[c].fg = has256 ? style.colour256 : style.colour16;
+        styles[c].bg = -1;
+    }
+    std::vector<std::string> transitions(COLOUR_COUNT * COLOUR_COUNT);
+    for (int from = 0; from < COLOUR_COUNT; ++from) {
+        for (int to = 0; to < COLOUR_COUNT; ++to) {
+            transitions[from * COLOUR_COUNT + to] = sgrTransition(styles[from], styles[to], has256);
+        }
+    }
+    frame.setPalette(transitions, COLOUR_COUNT);
+    havePalette = true;
+}
+
+void AnsiRenderer::resizeGrid(int w, int h) {
+    width = w;
+    height = h;
+    glyphs.assign(width * height, ' ');
+    colours.assign(width * height, COLOUR_PLAIN);
+    frame.reset(width, height, 2); // Below the score line
+}
+
+void AnsiRenderer::drawFrame(const int* cells, int w, int h, char (*glyphOf)(int), int score, int length) {
+    if (w != width || h != height) {
+        resizeGrid(w, h);
+    }
+    for (int i = 0; i < width * height; ++i) {
+        glyphs[i] = glyphOf(cells[i]);
+    }
+    const unsigned char* cellColours = NULL;
+    if (colour) {
+        if (!havePalette) buildPalette();
+        const unsigned char* colourOf = colourTable(length);
+        for (int i = 0; i < width * height; ++i) {
+            colours[i] = colourOf[cells[i]];
+        }
+        cellColours = &colours[0];
+    }
+    sendFrame(cellColours, score);
+}
+
+// Send the glyphs (and colours, if not NULL) as a diff, with the score line
+// if it changed, in one write()
+void AnsiRenderer::sendFrame(const unsigned char* cellColours, int score) {
+    const std::string& body = frame.encode(&glyphs[0], cellColours);
+
+    // The score line only goes out when it changes
+    if (score != lastScore) {
+        char line[48];
+        int len = snprintf(line, sizeof(line), "\x1b[1;1HScore: %d\x1b[K", score);
+        packet.assign(line, len);
+        packet += body;
+        lastScore = score;
+        writeAll(packet.data(), packet.size()); // One write() per frame
+    } else {
+        writeAll(body.data(), body.size());
+    }
+    frame.commit();
+}
+
+// Write everything, retrying only if the terminal takes part of it
+void AnsiRenderer::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(outputFd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        bytesOut += n;
+        data += n;
+        size -= n;
+    }
+}
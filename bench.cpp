@@ -0,0 +1,269 @@
+// Benchmarks every variant of the game with the same headless workload:
+// the autopilot plays a fixed set of seeds as fast as possible.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+#include "level.h"
+#include "policynet.h"
+#include "renderer.h"
+#include "replay.h"
+#include "savegame.h"
+#include "timing.h"
+#include "variants.h"
+
+// Workload settings
+int games = 200;        // Games per variant
+long maxTicks = 20000;  // Tick limit per game (forgiving variants never end)
+int difficulty = 5;
+bool wallsEnabled = true;
+LevelPack levels;       // Optional mazes; game g is played on level g % count
+int mapWidth = 0;       // Map size without levels (0 = default)
+int mapHeight = 0;
+int foodItems = 1;      // Pieces of food on the map at once
+Game start;             // Saved position every game starts from (--start)
+ReplayState startState;
+bool hasStart = false;
+
+// Set up game g: a new game, or the --start position with the game's own seed
+template <class Engine>
+void startGame(Engine& game, int g) {
+    game.foodItems = foodItems;
+    if (hasStart) {
+        if (game.mapWidth != start.mapWidth || game.mapHeight != start.mapHeight) {
+            game.resize(start.mapWidth, start.mapHeight);
+        }
+        game.restoreState(startState);
+        game.wallsEnabled = start.wallsEnabled;
+        game.seed(g + 1);
+        game.difficulty = difficulty;
+    } else {
+        game.seed(g + 1);
+        game.difficulty = difficulty;
+        game.wallsEnabled = wallsEnabled;
+        game.initMap();
+    }
+    game.running = true;
+}
+
+// Play every seed with one rule set and print the throughput
+template <class Engine>
+void benchmarkEngine(const char* name) {
+    long ticks = 0;
+    long totalScore = 0;
+    struct timespec start = monotonicNow();
+    for (int g = 0; g < games; ++g) {
+        Engine game;
+        if (levels.count() > 0) {
+            game.loadLevel(levels.level(g % levels.count()));
+        } else if (mapWidth > 0) {
+            game.resize(mapWidth, mapHeight);
+        }
+        startGame(game, g);
+        long gameTicks = 0;
+        while (game.running && gameTicks < maxTicks) {
+            int ch = game.autopilot();
+            if (ch != NO_KEY) {
+                game.changeDirection(ch);
+            }
+            game.update();
+            ++gameTicks;
+        }
+        ticks += gameTicks;
+        totalScore += game.score;
+    }
+    double seconds = secondsSince(start);
+    printf("%-8s %10ld ticks %8.3f s %12.0f ticks/s %8.1f avg score\n",
+           name, ticks, seconds, ticks / seconds, (double)totalScore / games);
+}
+
+// Draw every tick of the same games into /dev/null with the ANSI or
+// half-block renderer, to see what colour costs per frame. term picks 16
+// or 256 colours.
+void benchmarkRender(const char* label, bool halfBlock, bool colour, const char* term) {
+    setenv("TERM", term, 1);
+    int devnull = open("/dev/null", O_WRONLY);
+    AnsiRenderer* ansi = halfBlock ? new HalfBlockRenderer(devnull) : new AnsiRenderer(devnull);
+    AnsiRenderer& renderer = *ansi;
+    renderer.adaptive = false; // Measure every frame
+    renderer.colour = colour;
+    for (int g = 0; g < games; ++g) {
+        Snake6Engine game; // The full game, which ends when the snake crashes
+        if (mapWidth > 0) game.resize(mapWidth, mapHeight);
+        startGame(game, g);
+        for (long t = 0; game.running && t < maxTicks; ++t) {
+            int ch = game.autopilot();
+            if (ch != NO_KEY) {
+                game.changeDirection(ch);
+            }
+            game.update();
+            renderer.draw(&game.map[0], game.mapWidth, game.mapHeight, getMapValue, game.score, game.food);
+        }
+    }
+    close(devnull);
+    printf("%-22s %8ld frames %8.1f bytes/frame %8.2f us CPU/frame\n", label, renderer.stats.frames,
+           (double)renderer.stats.bytes / renderer.stats.frames, renderer.stats.cpuNanos / 1000.0 / renderer.stats.frames);
+    delete ansi;
+}
+
+// Forward every set of inputs with a kernel, count at a time, until a
+// quarter of a second has gone by; prints decisions per second
+static void timeKernel(const char* label, void (*kernel)(const PolicyNet&, const float*, float*, int),
+                       const PolicyNet& net, const std::vector<float>& features, int count) {
+    int sets = features.size() / NET_INPUTS;
+    std::vector<float> outputs(sets * NET_OUTPUTS);
+    long decisions = 0;
+    struct timespec start = monotonicNow();
+    double seconds = 0;
+    while (seconds < 0.25) {
+        for (int i = 0; i + count <= sets; i += count) {
+            kernel(net, &features[i * NET_INPUTS], &outputs[i * NET_OUTPUTS], count);
+        }
+        decisions += sets / count * count;
+        seconds = secondsSince(start);
+    }
+    printf("%-24s %12.0f decisions/s %8.1f ns each\n", label, decisions / seconds, seconds * 1e9 / decisions);
+}
+
+// Play the games with a network, then time its kernels on the inputs seen
+// along the way: one decision at a time, as a bot makes them, and in
+// batches across games
+void benchmarkNet(const PolicyNet& net) {
+    static const char keys[4] = {'w', 'd', 's', 'a'};
+    const size_t maxSets = 1 << 16;
+    std::vector<float> features;
+    float outputs[NET_OUTPUTS];
+    long ticks = 0;
+    struct timespec start = monotonicNow();
+    for (int g = 0; g < games; ++g) {
+        Snake2Engine game;
+        if (mapWidth > 0) game.resize(mapWidth, mapHeight);
+        startGame(game, g);
+        for (long t = 0; game.running && t < maxTicks; ++t, ++ticks) {
+            size_t at = features.size();
+            if (at < maxSets * NET_INPUTS) features.resize(at + NET_INPUTS);
+            else at = (ticks % maxSets) * NET_INPUTS;
+            netFeatures(game, false, &features[at]);
+            netForward(net, &features[at], outputs, 1);
+            game.changeDirection(keys[netChoice(outputs, game.direction)]);
+            game.update();
+        }
+    }
+    double seconds = secondsSince(start);
+    printf("Played %d games, %ld ticks: %.0f ticks/s with the %s kernel, inputs and engine included\n",
+           games, ticks, ticks / seconds, netKernel());
+
+    // The kernels must agree
+    int sets = features.size() / NET_INPUTS;
+    std::vector<float> scalar(sets * NET_OUTPUTS), simd(sets * NET_OUTPUTS);
+    netForwardScalar(net, &features[0], &scalar[0], sets);
+    netForward(net, &features[0], &simd[0], sets);
+    float worst = 0;
+    for (int i = 0; i < sets * NET_OUTPUTS; ++i) {
+        float difference = scalar[i] > simd[i] ? scalar[i] - simd[i] : simd[i] - scalar[i];
+        if (difference > worst) worst = difference;
+    }
+    printf("%d sets of inputs, largest difference between kernels %g\n", sets, worst);
+
+    timeKernel("scalar, one at a time", netForwardScalar, net, features, 1);
+    timeKernel("scalar, batches of 64", netForwardScalar, net, features, 64);
+    if (strcmp(netKernel(), "scalar") != 0) {
+        timeKernel("avx2, one at a time", netForward, net, features, 1);
+        timeKernel("avx2, batches of 64", netForward, net, features, 64);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool render = false;
+    const char* startPath = NULL;
+    const char* netPath = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && i + 1 < argc) {
+            wallsEnabled = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc) {
+            if (!levels.open(argv[++i])) {
+                fprintf(stderr, "%s: not a readable level pack\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &mapWidth, &mapHeight) != 2 || mapWidth < 3 || mapHeight < 3) {
+                fprintf(stderr, "Size must be WIDTHxHEIGHT\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--food") == 0 && i + 1 < argc) {
+            foodItems = atoi(argv[++i]);
+            if (foodItems < 1) foodItems = 1;
+        } else if (strcmp(argv[i], "--render") == 0) {
+            render = true;
+        } else if (strcmp(argv[i], "--start") == 0 && i + 1 < argc) {
+            startPath = argv[++i];
+        } else if (strcmp(argv[i], "--net") == 0 && i + 1 < argc) {
+            netPath = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--games N] [--ticks N] [--difficulty 1-9] [--walls y|n] [--levels PACK]\n"
+                            "       [--size WxH] [--food N] [--start FIXTURE] [--render] [--net FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (startPath != NULL && levels.count() > 0) {
+        fprintf(stderr, "--start brings its own board; it can't be used with --levels\n");
+        return 1;
+    }
+    if (startPath != NULL) {
+        // Every game starts from the fixture; time how long loading it takes
+        const int loads = 1000;
+        const char* error = NULL;
+        struct timespec loadStart = monotonicNow();
+        for (int i = 0; i < loads; ++i) {
+            hasStart = loadGame(startPath, start, FIXTURE_RULES, &error);
+            if (!hasStart) break;
+        }
+        if (!hasStart) {
+            fprintf(stderr, "%s: %s (fixtures come from ./fixture)\n", startPath, error);
+            return 1;
+        }
+        start.captureState(0, startState);
+        printf("Starting from %s: %dx%d, length %d, loaded in %.1f us\n", startPath, start.mapWidth,
+               start.mapHeight, start.food, secondsSince(loadStart) * 1e6 / loads);
+    }
+    if (render) {
+        benchmarkRender("monochrome", false, false, "xterm");
+        benchmarkRender("16 colours", false, true, "xterm");
+        benchmarkRender("256 colours", false, true, "xterm-256color");
+        benchmarkRender("half-block 16 colours", true, true, "xterm");
+        benchmarkRender("half-block 256 colours", true, true, "xterm-256color");
+        return 0;
+    }
+    if (netPath != NULL) {
+        NetFile file;
+        const char* error;
+        if (!file.open(netPath, &error)) {
+            fprintf(stderr, "%s: %s (networks come from ./evolve)\n", netPath, error);
+            return 1;
+        }
+        benchmarkNet(file.net());
+        return 0;
+    }
+    if (levels.count() > 0) {
+        printf("Playing across %d levels\n", levels.count());
+    }
+
+    benchmarkEngine<SnakeEngine>("snake");
+    benchmarkEngine<Snake2Engine>("snake2");
+    benchmarkEngine<Snake3Engine>("snake3");
+    benchmarkEngine<Snake4Engine>("snake4");
+    benchmarkEngine<Snake5Engine>("snake5");
+    benchmarkEngine<Snake6Engine>("snake6");
+    benchmarkEngine<Snake7Engine>("snake7");
+    return 0;
+}
@@ -0,0 +1,489 @@
+#include "bots.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+
+#include "timing.h"
+
+static const int dx[4] = {0, 1, 0, -1};
+static const int dy[4] = {-1, 0, 1, 0};
+static const char keys[4] = {'w', 'd', 's', 'a'};
+
+// Cell one step from (x, y) in direction d, or -1 if that leaves the map
+static int stepCell(const Game& game, int x, int y, int d, bool wraps) {
+    x += dx[d];
+    y += dy[d];
+    if (wraps) {
+        x = (x + game.mapWidth) % game.mapWidth;
+        y = (y + game.mapHeight) % game.mapHeight;
+    } else if (x < 0 || x >= game.mapWidth || y < 0 || y >= game.mapHeight) {
+        return -1;
+    }
+    return y * game.mapWidth + x;
+}
+
+// Whether moving onto a cell doesn't end in a collision
+static bool safeCell(const Game& game, int cell) {
+    return cell >= 0 && game.map[cell] != WALL && game.map[cell] <= 0;
+}
+
+void DecisionCache::resize(long entries) {
+    long size = 0;
+    if (entries > 0) {
+        size = 1;
+        while (size * 2 <= entries) size *= 2;
+    }
+    Slot empty = {0, NO_KEY, false};
+    slots.assign(size, empty);
+    mask = size > 0 ? size - 1 : 0;
+}
+
+Bot::Bot() : deadlineNanos(0) {
+    stats.calls = 0;
+    stats.nanos = 0;
+    stats.maxNanos = 0;
+    stats.late = 0;
+    stats.cached = 0;
+}
+
+void Bot::useCache(long entries) {
+    cache.resize(cacheable() ? entries : 0);
+}
+
+int Bot::play(const Game& game, bool wraps) {
+    struct timespec start = monotonicNow();
+    int key;
+    if (!cache.enabled()) {
+        key = decide(game, wraps);
+    } else {
+        uint64_t hash = game.stateHash() ^ (wraps ? zobristKey(ZOBRIST_WRAPS) : 0);
+        if (cache.find(hash, key)) {
+            stats.cached++;
+        } else {
+            key = decide(game, wraps);
+            cache.store(hash, key);
+        }
+    }
+    struct timespec end = monotonicNow();
+    long nanos = (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec);
+    stats.calls++;
+    stats.nanos += nanos;
+    if (nanos > stats.maxNanos) stats.maxNanos = nanos;
+    if (deadlineNanos > 0 && nanos > deadlineNanos) {
+        stats.late++;
+        return NO_KEY;
+    }
+    return key;
+}
+
+void Bot::printStats(FILE* out) const {
+    if (stats.calls == 0) return;
+    fprintf(out, "Bot %s: %ld decisions, %.0f ns average, %.1f us slowest, %ld late\n",
+            name(), stats.calls, (double)stats.nanos / stats.calls, stats.maxNanos / 1000.0, stats.late);
+    if (cache.enabled()) {
+        fprintf(out, "Bot %s: %ld decisions from the cache, %.1f%%\n", name(), stats.cached,
+                100.0 * stats.cached / stats.calls);
+    }
+}
+
+int GreedyBot::decide(const Game& game, bool wraps) {
+    return autopilotKey(game, wraps);
+}
+
+RandomBot::RandomBot() : state(1) {
+}
+
+void RandomBot::reset(uint64_t seed) {
+    state = seed * 0x9e3779b97f4a7c15ULL + 1; // Not the game's own sequence
+}
+
+int RandomBot::decide(const Game& game, bool wraps) {
+    int choices[3];
+    int count = 0;
+    for (int d = 0; d < 4; ++d) {
+        if (d == (game.direction + 2) % 4) continue; // Can't turn back on itself
+        if (safeCell(game, stepCell(game, game.headxpos, game.headypos, d, wraps))) {
+            choices[count++] = d;
+        }
+    }
+    if (count == 0) return NO_KEY;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return keys[choices[((state * 0x2545f4914f6cdd1dULL) >> 32) % count]];
+}
+
+FloodBot::FloodBot() : stamp(0) {
+}
+
+int FloodBot::reachable(const Game& game, int cell, bool wraps, int limit) {
+    if (seen.size() != game.map.size()) {
+        seen.assign(game.map.size(), 0);
+        stamp = 0;
+    }
+    if (++stamp == 0) {
+        // Stamps wrapped around, start over
+        memset(&seen[0], 0, seen.size() * sizeof(seen[0]));
+        stamp = 1;
+    }
+    queue.clear();
+    queue.push_back(cell);
+    seen[cell] = stamp;
+    for (size_t next = 0; next < queue.size() && (int)queue.size() < limit; ++next) {
+        int x = queue[next] % game.mapWidth;
+        int y = queue[next] / game.mapWidth;
+        for (int d = 0; d < 4; ++d) {
+            int neighbour = stepCell(game, x, y, d, wraps);
+            if (safeCell(game, neighbour) && seen[neighbour] != stamp) {
+                seen[neighbour] = stamp;
+                queue.push_back(neighbour);
+            }
+        }
+    }
+    return queue.size();
+}
+
+int FloodBot::decide(const Game& game, bool wraps) {
+    int target = nearestFood(game, wraps);
+    int targetx = target >= 0 ? target % game.mapWidth : game.headxpos;
+    int targety = target >= 0 ? target / game.mapWidth : game.headypos;
+
+    // Prefer moves into enough room for the whole snake, then the closest to the food
+    int best = NO_KEY;
+    int bestRoom = -1;
+    int bestDistance = 0;
+    for (int d = 0; d < 4; ++d) {
+        if (d == (game.direction + 2) % 4) continue; // Can't turn back on itself
+        int cell = stepCell(game, game.headxpos, game.headypos, d, wraps);
+        if (!safeCell(game, cell)) continue;
+        int room = reachable(game, cell, wraps, game.food + 1);
+        if (room > game.food) room = game.food + 1; // Enough is enough
+        int distance = abs(targetx - cell % game.mapWidth) + abs(targety - cell / game.mapWidth);
+        if (room > bestRoom || (room == bestRoom && distance < bestDistance)) {
+            best = keys[d];
+            bestRoom = room;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+PathBot::PathBot(bool timeAware)
+    : searchLimit(4096), bodyPaths(0), timeAware(timeAware), stamp(0), queueEnd(0) {
+}
+
+void PathBot::startSearch(const Game& game) {
+    if (visits.size() != game.map.size()) {
+        Visit none = {0, 0, 0, 0};
+        visits.assign(game.map.size(), none);
+        queue.resize(game.map.size());
+        deferred.resize(game.map.size());
+        stamp = 0;
+    }
+    if (++stamp == 0) {
+        // Stamps wrapped around, start over
+        for (size_t i = 0; i < visits.size(); ++i) visits[i].stamp = 0;
+        stamp = 1;
+    }
+    queueEnd = 0;
+}
+
+void PathBot::enqueue(const Game& game, int x, int y, int time, int ate, int from) {
+    Visit& visit = visits[y * game.mapWidth + x];
+    visit.stamp = stamp;
+    visit.arrival = time;
+    visit.eaten = ate;
+    visit.parent = from;
+    queue[queueEnd++] = y << 16 | x;
+}
+
+bool PathBot::roomAfter(const Game& game, bool wraps, int& room) {
+    // Locals, so the compiler needn't reload them after every store. Cells
+    // are queued as y << 16 | x, so nothing is divided to find a neighbour.
+    const int width = game.mapWidth;
+    const int height = game.mapHeight;
+    const int* map = &game.map[0];
+    Visit* visit = &visits[0];
+    int* queued = &queue[0];
+    int end = queueEnd;
+    const unsigned int current = stamp;
+
+    // Enough room is room for the whole snake, or none at all once the
+    // snake can catch up with its tail
+    int enough = game.food + 1;
+    for (int next = 0; next < end && end <= enough; ++next) {
+        int x = queued[next] & 0xffff;
+        int y = queued[next] >> 16;
+        int cell = y * width + x;
+        int time = visit[cell].arrival + 1;
+        int ate = visit[cell].eaten;
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + dx[d];
+            int ny = y + dy[d];
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+                if (!wraps) continue;
+                nx = (nx + width) % width;
+                ny = (ny + height) % height;
+            }
+            int neighbour = ny * width + nx;
+            if (visit[neighbour].stamp == current) continue;
+            int value = map[neighbour];
+            if (value == WALL) continue;
+            if (value > 0) {
+                // The tail will have left it by then: the body moves up one
+                // cell per move, except on a move that eats
+                if (timeAware && time - ate > value) enough = 0;
+                continue;
+            }
+            Visit& reached = visit[neighbour];
+            reached.stamp = current;
+            reached.arrival = time;
+            reached.eaten = ate + (isFood(value) ? 1 : 0);
+            reached.parent = cell;
+            queued[end++] = ny << 16 | nx;
+        }
+    }
+    queueEnd = end;
+    room = end;
+    return end > enough;
+}
+
+// Moves from (x, y) to (tx, ty) with nothing in the way
+static int distance(const Game& game, int x, int y, int tx, int ty, bool wraps) {
+    int across = abs(x - tx);
+    int down = abs(y - ty);
+    if (wraps) {
+        if (across > game.mapWidth - across) across = game.mapWidth - across;
+        if (down > game.mapHeight - down) down = game.mapHeight - down;
+    }
+    return across + down;
+}
+
+int PathBot::findFood(const Game& game, bool wraps, int target) {
+    // A*: each step either brings the target one closer, keeping the estimate
+    // of the whole path, or takes it one further, adding two. So cells go on
+    // one of two stacks, and the second one is taken up when the first runs out.
+    const int width = game.mapWidth;
+    const int height = game.mapHeight;
+    const int* map = &game.map[0];
+    Visit* visit = &visits[0];
+    int* open = &queue[0];
+    int* later = &deferred[0];
+    int openEnd = queueEnd;
+    int laterEnd = 0;
+    const unsigned int current = stamp;
+    int tx = target % width;
+    int ty = target / width;
+    for (int looked = 0; openEnd > 0 && looked < searchLimit; ++looked) {
+        int x = open[--openEnd] & 0xffff;
+        int y = open[openEnd] >> 16;
+        int cell = y * width + x;
+        int time = visit[cell].arrival + 1;
+        int ate = visit[cell].eaten;
+        int before = distance(game, x, y, tx, ty, wraps);
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + dx[d];
+            int ny = y + dy[d];
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+                if (!wraps) continue;
+                nx = (nx + width) % width;
+                ny = (ny + height) % height;
+            }
+            int neighbour = ny * width + nx;
+            if (visit[neighbour].stamp == current) continue;
+            int value = map[neighbour];
+            if (value == WALL) continue;
+            if (value > 0 && !(timeAware && time - ate > value)) continue;
+            Visit& reached = visit[neighbour];
+            reached.stamp = current;
+            reached.arrival = time;
+            reached.eaten = ate;
+            reached.parent = cell;
+            if (isFood(value)) return neighbour; // The target, or food on the way
+            if (distance(game, nx, ny, tx, ty, wraps) < before) {
+                open[openEnd++] = ny << 16 | nx;
+            } else {
+                later[laterEnd++] = ny << 16 | nx;
+            }
+        }
+        if (openEnd == 0) {
+            int* swap = open;
+            open = later;
+            later = swap;
+            openEnd = laterEnd;
+            laterEnd = 0;
+        }
+    }
+    return -1;
+}
+
+int PathBot::decide(const Game& game, bool wraps) {
+    // Nearest food in moves, through the body where it will have moved on
+    startSearch(game);
+    enqueue(game, game.headxpos, game.headypos, 0, 0, -1);
+    int head = game.headypos * game.mapWidth + game.headxpos;
+    int target = nearestFood(game, wraps);
+    if (target >= 0) target = findFood(game, wraps, target);
+    if (target >= 0) {
+        // Walk back to the first step, keeping the path's cells to block
+        path.clear();
+        bool crossesBody = false;
+        int first = target;
+        for (int cell = target; cell != head; cell = visits[cell].parent) {
+            path.push_back(cell);
+            crossesBody = crossesBody || game.map[cell] > 0;
+            first = cell;
+        }
+        // Once there, one longer, the snake must still have room or reach its tail
+        int time = visits[target].arrival;
+        startSearch(game);
+        for (size_t i = 1; i < path.size(); ++i) {
+            visits[path[i]].stamp = stamp; // The new body, gone long after anything else
+        }
+        enqueue(game, target % game.mapWidth, target / game.mapWidth, time, 1, -1);
+        int room;
+        if (roomAfter(game, wraps, room)) {
+            if (crossesBody) bodyPaths++;
+            return keys[moveTowards(game, head, first, wraps)];
+        }
+    }
+
+    // Otherwise the move with room to live in, or failing that the most room.
+    // A move into space an earlier move's search went all through has the same room.
+    int best = -1;
+    int bestRoom = 0;
+    unsigned int firstFlood = stamp + 1;
+    int floodRooms[4];
+    for (int d = 0; d < 4; ++d) {
+        int cell = stepCell(game, game.headxpos, game.headypos, d, wraps);
+        if (!safeCell(game, cell)) continue;
+        int room;
+        unsigned int reachedBy = visits[cell].stamp;
+        if (reachedBy >= firstFlood && reachedBy <= stamp) {
+            room = floodRooms[reachedBy - firstFlood];
+        } else {
+            startSearch(game);
+            visits[head].stamp = stamp;
+            enqueue(game, cell % game.mapWidth, cell / game.mapWidth, 1, isFood(game.map[cell]) ? 1 : 0, head);
+            if (roomAfter(game, wraps, room)) return keys[d];
+            if (stamp >= firstFlood) floodRooms[stamp - firstFlood] = room; // Unless stamps wrapped
+        }
+        if (room > bestRoom) {
+            best = d;
+            bestRoom = room;
+        }
+    }
+    return best < 0 ? NO_KEY : keys[best]; // NO_KEY when boxed in
+}
+
+// Direction of the step from one cell to the next one
+int PathBot::moveTowards(const Game& game, int from, int to, bool wraps) {
+    int x = from % game.mapWidth;
+    int y = from / game.mapWidth;
+    for (int d = 0; d < 4; ++d) {
+        if (stepCell(game, x, y, d, wraps) == to) return d;
+    }
+    return game.direction;
+}
+
+void PathBot::printStats(FILE* out) const {
+    Bot::printStats(out);
+    if (stats.calls > 0 && timeAware) {
+        fprintf(out, "Bot %s: %ld paths to food through cells the body was still in\n", name(), bodyPaths);
+    }
+}
+
+bool NetBot::load(const char* path) {
+    const char* error;
+    if (!file.open(path, &error)) {
+        fprintf(stderr, "%s: %s\n", path, error);
+        return false;
+    }
+    return true;
+}
+
+int NetBot::decide(const Game& game, bool wraps) {
+    return keys[netDirection(file.net(), game, wraps)];
+}
+
+PluginBot::PluginBot()
+    : path(""), library(NULL), decideFunction(NULL), resetFunction(NULL), tick(0) {
+}
+
+PluginBot::~PluginBot() {
+    if (library != NULL) dlclose(library);
+}
+
+bool PluginBot::load(const char* path) {
+    this->path = path;
+    library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (library == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        return false;
+    }
+    SnakeBotAbiFunction abi = reinterpret_cast<SnakeBotAbiFunction>(dlsym(library, "snake_bot_abi"));
+    decideFunction = reinterpret_cast<SnakeBotDecideFunction>(dlsym(library, "decide"));
+    resetFunction = reinterpret_cast<SnakeBotResetFunction>(dlsym(library, "snake_bot_reset"));
+    if (abi == NULL || decideFunction == NULL) {
+        fprintf(stderr, "%s: doesn't export snake_bot_abi() and decide()\n", path);
+        return false;
+    }
+    if (abi() != SNAKE_BOT_ABI) {
+        fprintf(stderr, "%s: built for bot ABI %d, not %d\n", path, abi(), SNAKE_BOT_ABI);
+        return false;
+    }
+    return true;
+}
+
+void PluginBot::reset(uint64_t seed) {
+    tick = 0;
+    if (resetFunction != NULL) resetFunction(seed);
+}
+
+int PluginBot::decide(const Game& game, bool wraps) {
+    // The map's ints are the view's int32s, so the board is handed over as is
+    static_assert(sizeof(int) == sizeof(int32_t), "map cells must be 32-bit");
+    SnakeView view;
+    view.cells = reinterpret_cast<const int32_t*>(&game.map[0]);
+    view.width = game.mapWidth;
+    view.height = game.mapHeight;
+    view.headx = game.headxpos;
+    view.heady = game.headypos;
+    view.direction = game.direction;
+    view.food = game.food;
+    view.score = game.score;
+    view.wraps = wraps;
+    view.tick = tick++;
+    int key = decideFunction(&view);
+    return (key == 'w' || key == 'a' || key == 's' || key == 'd') ? key : NO_KEY;
+}
+
+Bot* createBot(const char* name) {
+    if (strncmp(name, "net:", 4) == 0) {
+        NetBot* bot = new NetBot();
+        if (!bot->load(name + 4)) {
+            delete bot;
+            return NULL;
+        }
+        return bot;
+    }
+    if (strchr(name, '/') != NULL) {
+        PluginBot* bot = new PluginBot();
+        if (!bot->load(name)) {
+            delete bot;
+            return NULL;
+        }
+        return bot;
+    }
+    if (strcmp(name, "greedy") == 0) return new GreedyBot();
+    if (strcmp(name, "random") == 0) return new RandomBot();
+    if (strcmp(name, "flood") == 0) return new FloodBot();
+    if (strcmp(name, "path") == 0) return new PathBot(true);
+    if (strcmp(name, "bfs") == 0) return new PathBot(false);
+    return NULL;
+}
+
+const char* botNames() {
+    return "greedy random flood path bfs net:FILE ./PLUGIN.so";
+}
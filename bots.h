@@ -0,0 +1,233 @@
+#ifndef BOTS_H
+#define BOTS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "game.h"
+#include "policynet.h"
+#include "snakebot.h"
+
+// Per-bot counters, kept by Bot::play()
+struct BotStats {
+    long calls;    // Decisions asked for
+    long nanos;    // Time spent deciding
+    long maxNanos; // Slowest decision
+    long late;     // Decisions past the deadline, thrown away
+    long cached;   // Decisions found in the cache instead
+};
+
+// Decisions remembered by position (Game::stateHash()), so a bot that
+// comes back to a position, as when chasing its tail round a loop, doesn't
+// search again. A fixed number of slots, each holding the last position
+// that hashed to it.
+class DecisionCache {
+public:
+    DecisionCache() : mask(0) {}
+
+    // Keep up to entries decisions, rounded down to a power of two; 0 = none
+    void resize(long entries);
+
+    bool enabled() const { return !slots.empty(); }
+
+    bool find(uint64_t hash, int& key) const {
+        const Slot& slot = slots[hash & mask];
+        if (!slot.used || slot.hash != hash) return false;
+        key = slot.key;
+        return true;
+    }
+
+    void store(uint64_t hash, int key) {
+        Slot& slot = slots[hash & mask];
+        slot.hash = hash;
+        slot.key = key;
+        slot.used = true;
+    }
+
+private:
+    struct Slot {
+        uint64_t hash;
+        int key;
+        bool used;
+    };
+    std::vector<Slot> slots;
+    uint64_t mask;
+};
+
+// A policy that plays the game: each tick it looks at the game and picks
+// the key to press. Bots keep their scratch buffers between calls, so one
+// instance must not be shared between threads.
+class Bot {
+public:
+    Bot();
+    virtual ~Bot() {}
+
+    virtual const char* name() const = 0;
+
+    // Called before each game, with the game's seed
+    virtual void reset(uint64_t seed) { (void)seed; }
+
+    // Key to press this tick, or NO_KEY to keep going straight.
+    // wraps says whether leaving the map comes back on the other side.
+    virtual int decide(const Game& game, bool wraps) = 0;
+
+    // Whether decide() depends on nothing but the position, so its
+    // decisions can be cached
+    virtual bool cacheable() const { return true; }
+
+    // Remember up to entries decisions by position (0 = none, the default).
+    // Does nothing for a bot that isn't cacheable().
+    void useCache(long entries);
+
+    // Ask decide(), or the cache, and time it. A decision slower than the
+    // deadline arrives too late to count, so the snake goes straight instead.
+    int play(const Game& game, bool wraps);
+
+    // Print the collected statistics
+    virtual void printStats(FILE* out) const;
+
+    BotStats stats;
+    long deadlineNanos; // 0 = no deadline
+
+private:
+    DecisionCache cache;
+};
+
+// Heads straight for the nearest food, avoiding only the next cell (the autopilot)
+class GreedyBot : public Bot {
+public:
+    const char* name() const { return "greedy"; }
+    int decide(const Game& game, bool wraps);
+};
+
+// Any move that doesn't crash right away, picked at random
+class RandomBot : public Bot {
+public:
+    RandomBot();
+    const char* name() const { return "random"; }
+    bool cacheable() const { return false; }
+    void reset(uint64_t seed);
+    int decide(const Game& game, bool wraps);
+
+private:
+    uint64_t state;
+};
+
+// Like greedy, but won't enter a pocket smaller than the snake: each move
+// is checked with a flood fill of the space it leads into
+class FloodBot : public Bot {
+public:
+    FloodBot();
+    const char* name() const { return "flood"; }
+    int decide(const Game& game, bool wraps);
+
+private:
+    // Free cells reachable from cell, counting no further than limit
+    int reachable(const Game& game, int cell, bool wraps, int limit);
+
+    std::vector<unsigned int> seen; // Visit stamps, so nothing is cleared between fills
+    unsigned int stamp;
+    std::vector<int> queue;
+};
+
+// Shortest path to the nearest food, by a breadth-first search in order of
+// arrival time. A body cell's value is how many moves it has left before
+// the tail leaves it, so with timeAware a body cell counts as open if the
+// head would get there after that, one move later for each piece of food
+// eaten on the way. Without timeAware the body is a wall ("bfs", for
+// comparison). A path is only taken if, after eating, the snake still has
+// room for itself or can catch up with its tail; otherwise the bot picks
+// the move that does, or the roomiest. Searches stop early once they know
+// the answer, look at no more than searchLimit cells and keep their
+// buffers between calls.
+class PathBot : public Bot {
+public:
+    explicit PathBot(bool timeAware);
+    const char* name() const { return timeAware ? "path" : "bfs"; }
+    int decide(const Game& game, bool wraps);
+    void printStats(FILE* out) const;
+
+    int searchLimit; // Cells looked at per search at most
+    long bodyPaths;  // Decisions heading for food through the body
+
+private:
+    // Start a new search with nothing queued
+    void startSearch(const Game& game);
+
+    // Queue a cell reached at a time, having eaten some food, from a cell
+    void enqueue(const Game& game, int x, int y, int time, int ate, int from);
+
+    // Search on from the queued cells for the way to the food nearest to
+    // target, heading for target first. Returns the food reached, or -1.
+    int findFood(const Game& game, bool wraps, int target);
+
+    // Search on from the queued cells, in order of arrival, for room to
+    // live in: for the whole snake, or to keep going until the tail has left
+    // a body cell next to it. Returns whether there is, and the cells seen.
+    bool roomAfter(const Game& game, bool wraps, int& room);
+
+    int moveTowards(const Game& game, int from, int to, bool wraps);
+
+    // What a search knows about a cell, together so a visit touches one cache line
+    struct Visit {
+        unsigned int stamp; // Search that reached it, so nothing is cleared between searches
+        int arrival;        // Moves until the head gets there
+        int eaten;          // Food eaten on the way
+        int parent;         // Cell it was reached from
+    };
+
+    bool timeAware;
+    std::vector<Visit> visits;
+    unsigned int stamp;
+    std::vector<int> queue;    // Cells reached, in order, as y << 16 | x
+    std::vector<int> deferred; // Cells findFood() takes up next
+    int queueEnd;
+    std::vector<int> path;    // Cells of the path to the food, last first
+};
+
+// Plays a network trained by ./evolve, mapped from a .net file
+class NetBot : public Bot {
+public:
+    // Map the network. Prints why and returns false if it can't be used.
+    bool load(const char* path);
+
+    const char* name() const { return "net"; }
+    int decide(const Game& game, bool wraps);
+
+private:
+    NetFile file;
+};
+
+// A bot from a shared library, see snakebot.h. decide() hands the library a
+// view pointing straight into the game's map.
+class PluginBot : public Bot {
+public:
+    PluginBot();
+    ~PluginBot();
+
+    // Load the library. Prints why and returns false if it can't be used.
+    bool load(const char* path);
+
+    const char* name() const { return path; }
+    bool cacheable() const { return false; } // The library may keep state of its own
+    void reset(uint64_t seed);
+    int decide(const Game& game, bool wraps);
+
+private:
+    const char* path;
+    void* library;
+    SnakeBotDecideFunction decideFunction;
+    SnakeBotResetFunction resetFunction;
+    long tick;
+};
+
+// Make a bot by name, load a network when the name is net:FILE, or load a
+// plugin when the name is a path to a .so (it contains a '/'). Returns NULL
+// for an unknown name, a bad network or a bad plugin.
+Bot* createBot(const char* name);
+
+// Names createBot() knows, separated by spaces
+const char* botNames();
+
+#endif
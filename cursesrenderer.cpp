@@ -0,0 +1,111 @@
+#include "renderer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <unistd.h>
+
+bool CursesRenderer::init() {
+    if (initscr() == NULL) return false; // Start ncurses mode
+    nodelay(stdscr, TRUE); // Non-blocking input
+    noecho(); // Don't echo pressed keys to the screen
+    curs_set(FALSE); // Hide the cursor
+
+    // One colour pair per tile colour, on the terminal's own background
+    for (int c = 0; c < COLOUR_COUNT; ++c) {
+        colourAttrs[c] = A_NORMAL;
+    }
+    if (colour && has_colors()) {
+        start_color();
+        use_default_colors();
+        for (int c = 1; c < COLOUR_COUNT && c < COLOR_PAIRS; ++c) {
+            const ColourStyle& style = colourStyle(c);
+            int foreground = COLORS >= 256 ? style.colour256 : style.colour16;
+            if (foreground >= COLORS) foreground %= 8; // Eight-colour terminal
+            init_pair(c, foreground, -1);
+            colourAttrs[c] = COLOR_PAIR(c) | (style.intensity == 1 ? A_BOLD : style.intensity == 2 ? A_DIM : 0);
+        }
+    }
+    return true;
+}
+
+void CursesRenderer::shutdown() {
+    endwin(); // End ncurses mode
+}
+
+int CursesRenderer::readKey() {
+    return getch();
+}
+
+void CursesRenderer::showMessage(const char* text) {
+    clear();
+    printw("%s\n", text);
+    refresh();
+    boardLost();
+}
+
+void CursesRenderer::drawStatus(int row, const char* text) {
+    mvprintw(row, 0, "%s", text);
+    clrtoeol();
+    refresh();
+}
+
+// Print the map to the console
+void CursesRenderer::drawFrame(const int* cells, int width, int height, char (*glyphOf)(int), int score, int length) {
+    clear();
+    // Print the score at the top of the screen
+    mvprintw(0, 0, "Score: %d", score);
+
+    // Print the game map below the score
+    if (!colour) {
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                mvaddch(y + 1, x, glyphOf(cells[y * width + x]));
+            }
+        }
+    } else {
+        // Change the attribute once per run of cells in the same colour
+        const unsigned char* colourOf = colourTable(length);
+        int current = COLOUR_PLAIN;
+        for (int y = 0; y < height; ++y) {
+            move(y + 1, 0);
+            for (int x = 0; x < width; ++x) {
+                int cell = cells[y * width + x];
+                int c = colourOf[cell];
+                if (c != current) {
+                    attrset(colourAttrs[c]);
+                    current = c;
+                }
+                addch(glyphOf(cell));
+            }
+        }
+        attrset(A_NORMAL);
+    }
+    refresh();
+}
+
+// The calling thread's I/O counters, opened once per thread and closed when it ends
+struct ThreadIo {
+    int fd;
+    ThreadIo() : fd(::open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC)) {}
+    ~ThreadIo() {
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+// ncurses has no hook on its output, and writes straight to the terminal's
+// descriptor, so use the kernel's count of bytes written by the thread
+// drawing (0 if the kernel doesn't provide it). Other threads' writes, the
+// event log's or the score log's, aren't counted; the frame stream is
+// written after the frame, outside the count.
+long CursesRenderer::outputCounter() {
+    static thread_local ThreadIo io;
+    if (io.fd < 0) return 0;
+    char text[512];
+    ssize_t n = pread(io.fd, text, sizeof(text) - 1, 0);
+    if (n <= 0) return 0;
+    text[n] = 0;
+    const char* written = strstr(text, "wchar:");
+    return written != NULL ? atol(written + 6) : 0;
+}
@@ -0,0 +1,167 @@
+// Training data: plays headless games with any bot and writes every tick
+// as the board before the move, the move, what it scored, whether the
+// game ended and whether --ticks cut it short, for learning from offline.
+//
+//   ./dataset --bot flood --games 1000 --rules snake2 -o flood
+//
+// writes flood-00000-planes.npy, flood-00000-action.npy, ... (see
+// npywriter.h), which numpy.load() reads as they are. Game g is played with
+// seed --seed + g, one after the other, so chunks follow the games in
+// order and a game can run on from one chunk into the next.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "bots.h"
+#include "npywriter.h"
+#include "planes.h"
+#include "timing.h"
+#include "variants.h"
+
+using namespace std;
+
+// Settings
+const char* botName = "greedy";
+long games = 100;
+uint64_t firstSeed = 1;
+long maxTicks = 20000;      // Tick limit per game
+int difficulty = 5;
+bool wallsEnabled = true;
+int mapWidth = 0;           // 0 = default size
+int mapHeight = 0;
+int foodItems = 1;
+int chunkTicks = 4096;      // Ticks per chunk of files
+const char* outPrefix = "dataset";
+
+// Time one way of encoding the planes, on the board a game ended with
+template <class Engine>
+double encodeNanos(void (*encode)(const Game&, float*), const Engine& game) {
+    vector<float> planes(PLANES * game.mapSize);
+    const int rounds = 20000;
+    long start = threadCpuNanos();
+    for (int r = 0; r < rounds; ++r) {
+        encode(game, &planes[0]);
+    }
+    return (double)(threadCpuNanos() - start) / rounds;
+}
+
+// Play every game under one rule set, writing each tick as it goes
+template <class Engine>
+int writeDataset() {
+    Bot* bot = createBot(botName);
+    Engine game;
+    if (mapWidth > 0) {
+        game.resize(mapWidth, mapHeight);
+    }
+    game.foodItems = foodItems;
+    game.difficulty = difficulty;
+    game.wallsEnabled = wallsEnabled;
+
+    NpyWriter writer;
+    writer.open(outPrefix, game.mapWidth, game.mapHeight, chunkTicks);
+    struct timespec start = monotonicNow();
+    for (long g = 0; g < games; ++g) {
+        game.seed(firstSeed + g);
+        game.initMap();
+        game.running = true;
+        bot->reset(firstSeed + g);
+        for (long t = 0; game.running && t < maxTicks; ++t) {
+            encodePlanes(game, writer.planes());
+            int ch = bot->play(game, Engine::Walls::wraps);
+            if (ch != NO_KEY) {
+                game.changeDirection(ch);
+            }
+            int action = game.direction;
+            int score = game.score;
+            game.update();
+            // Running out of ticks isn't the game ending: the state still has a future
+            writer.add(action, game.score - score, !game.running, game.running && t + 1 == maxTicks);
+        }
+    }
+    bool ok = writer.close();
+    double seconds = secondsSince(start);
+
+    const NpyWriter::Stats& st = writer.stats;
+    printf("%ld games, %ld ticks in %.2f s: %.0f ticks/s\n", games, st.ticks, seconds, st.ticks / seconds);
+    printf("%ld chunks, %.1f MB: %.2f GB/min, game thread waited %.1f ms for the disk\n",
+           st.chunks, st.bytes / 1e6, st.bytes / 1e9 / seconds * 60, st.waitNanos / 1e6);
+    printf("Encoding the planes of a %dx%d board: %.0f ns scalar", game.mapWidth, game.mapHeight,
+           encodeNanos(encodePlanesScalar, game));
+    if (strcmp(planesKernel(), "scalar") != 0) {
+        printf(", %.0f ns %s", encodeNanos(encodePlanes, game), planesKernel());
+    }
+    printf("\n");
+    bot->printStats(stdout);
+    delete bot;
+    if (!ok) {
+        fprintf(stderr, "Some chunks couldn't be written\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rules = "snake2";
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) {
+            botName = argv[++i];
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = atol(argv[++i]);
+            ok = games > 0;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            firstSeed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules = argv[++i];
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = atol(argv[++i]);
+            ok = maxTicks > 0;
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && i + 1 < argc) {
+            wallsEnabled = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            ok = sscanf(argv[++i], "%dx%d", &mapWidth, &mapHeight) == 2 && mapWidth >= 3 && mapHeight >= 3 &&
+                 mapWidth <= 4096 && mapHeight <= 4096;
+        } else if (strcmp(argv[i], "--food") == 0 && i + 1 < argc) {
+            foodItems = atoi(argv[++i]);
+            if (foodItems < 1) foodItems = 1;
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunkTicks = atoi(argv[++i]);
+            ok = chunkTicks > 0;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outPrefix = argv[++i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Usage: %s [--bot NAME] [--games N] [--seed N] [--rules snake|snake2..snake7]\n"
+                        "       [--ticks N] [--difficulty 1-9] [--walls y|n] [--size WxH] [--food N]\n"
+                        "       [--chunk TICKS] [-o PREFIX]\n"
+                        "Bots: %s\n", argv[0], botNames());
+        return 1;
+    }
+    Bot* bot = createBot(botName);
+    if (bot == NULL) {
+        fprintf(stderr, "Unknown bot: %s (have: %s)\n", botName, botNames());
+        return 1;
+    }
+    delete bot;
+
+    printf("Rules %s, bot %s, seeds %llu-%llu, difficulty %d, walls %s\n", rules, botName,
+           (unsigned long long)firstSeed, (unsigned long long)(firstSeed + games - 1), difficulty,
+           wallsEnabled ? "on" : "off");
+    if (strcmp(rules, "snake") == 0) return writeDataset<SnakeEngine>();
+    if (strcmp(rules, "snake2") == 0) return writeDataset<Snake2Engine>();
+    if (strcmp(rules, "snake3") == 0) return writeDataset<Snake3Engine>();
+    if (strcmp(rules, "snake4") == 0) return writeDataset<Snake4Engine>();
+    if (strcmp(rules, "snake5") == 0) return writeDataset<Snake5Engine>();
+    if (strcmp(rules, "snake6") == 0) return writeDataset<Snake6Engine>();
+    if (strcmp(rules, "snake7") == 0) return writeDataset<Snake7Engine>();
+    fprintf(stderr, "Unknown rules: %s\n", rules);
+    return 1;
+}
@@ -0,0 +1,626 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <unistd.h>
+
+#include "bots.h"
+#include "engine.h"
+#include "eventlog.h"
+#include "framestream.h"
+#include "options.h"
+#include "renderer.h"
+#include "replay.h"
+#include "savegame.h"
+#include "scorelog.h"
+#include "spscqueue.h"
+#include "timing.h"
+#include "triplebuffer.h"
+
+// A copy of the board handed from the game thread to the render thread
+struct BoardSnapshot {
+    long tick;
+    int score;
+    int length;
+    std::vector<int> cells;
+};
+
+// Runs one variant of the game: the terminal, the main loop, the render
+// thread, spectator streams and replays. Engine is an Engine<...> rule set.
+template <class Engine>
+class Driver {
+public:
+    Driver() : renderer(NULL), bot(NULL), renderStop(false), resumed(false), lastGameSeed(0), lastGameTicks(0),
+               lastGameSeconds(0), gameTicks(0), gameSeconds(0), renderSkipped(0), renderSeconds(0) {
+        memset(&session, 0, sizeof(session));
+    }
+
+    int main(int argc, char** argv) {
+        if (!parseOptions(argc, argv, options)) return 1;
+        game.seed(options.seed);
+
+        if (options.levelPath != NULL) {
+            if (!levelPack.open(options.levelPath)) {
+                fprintf(stderr, "%s: not a readable level pack\n", options.levelPath);
+                return 1;
+            }
+            int index = options.levelName != NULL ? levelPack.find(options.levelName) : 0;
+            if (index < 0 || index >= levelPack.count()) {
+                fprintf(stderr, "%s: no level %s\n", options.levelPath, options.levelName != NULL ? options.levelName : "");
+                return 1;
+            }
+            game.loadLevel(levelPack.level(index));
+        } else if (options.mapWidth > 0) {
+            game.resize(options.mapWidth, options.mapHeight);
+        }
+        game.foodItems = options.foodItems;
+        game.foodValues = options.foodValues;
+
+        if (options.replayPath != NULL) {
+            if (!replayReader.open(options.replayPath)) {
+                fprintf(stderr, "%s: not a readable replay\n", options.replayPath);
+                return 1;
+            }
+            if (replayReader.rules() != Engine::rules) {
+                fprintf(stderr, "%s: recorded with a different variant of the game\n", options.replayPath);
+                return 1;
+            }
+            if (game.hasLevel()) {
+                // The level's food zones are needed to re-simulate
+                if (replayReader.width() != game.mapWidth || replayReader.height() != game.mapHeight) {
+                    fprintf(stderr, "%s: recorded on a different level\n", options.replayPath);
+                    return 1;
+                }
+            } else {
+                game.resize(replayReader.width(), replayReader.height());
+            }
+            // Food is placed from the same random numbers only with the same settings
+            game.foodItems = replayReader.foodItems();
+            game.foodValues = replayReader.foodValues();
+        }
+
+        if (options.resumePath != NULL) {
+            const char* error;
+            if (!loadGame(options.resumePath, game, Engine::rules, &error)) {
+                fprintf(stderr, "%s: %s\n", options.resumePath, error);
+                return 1;
+            }
+            resumed = true;
+        }
+
+        if (options.streamPath != NULL && !frameStream.open(options.streamPath)) {
+            perror(options.streamPath);
+            return 1;
+        }
+        if (options.streamFd >= 0 && !frameStream.attach(options.streamFd)) {
+            perror("--stream-fd");
+            return 1;
+        }
+        frameStream.reset(game.mapWidth, game.mapHeight);
+
+        if (options.eventsPath != NULL && options.replayPath == NULL && !eventLog.open(options.eventsPath)) {
+            perror(options.eventsPath);
+            return 1;
+        }
+
+        if (options.botName != NULL || options.headless) {
+            bot = createBot(options.botName != NULL ? options.botName : "greedy");
+            if (bot == NULL) {
+                fprintf(stderr, "Unknown bot: %s (have: %s)\n", options.botName, botNames());
+                return 1;
+            }
+            bot->deadlineNanos = options.botDeadlineMicros * 1000L;
+            bot->useCache(options.botCacheEntries);
+        }
+
+        if (options.headless) {
+            options.threaded = false; // Nothing to draw
+        } else {
+            renderer = createRenderer(options.rendererName);
+            if (renderer == NULL) {
+                fprintf(stderr, "Unknown renderer: %s\n", options.rendererName);
+                return 1;
+            }
+            renderer->adaptive = options.frameSkip;
+            renderer->colour = options.colour;
+            if (!renderer->init()) {
+                fprintf(stderr, "Can't use the terminal with the %s renderer\n", options.rendererName);
+                delete renderer;
+                return 1;
+            }
+        }
+
+        if (options.scoresPath != NULL && options.replayPath == NULL) {
+            if (!scoreLog.open(options.scoresPath)) {
+                perror(options.scoresPath);
+                return 1;
+            }
+            if (scoreLog.needsCompaction()) {
+                scoreLog.compactInBackground(); // Done by the time the game is
+            }
+        }
+
+        if (options.replayPath == NULL) {
+            if (!resumed) chooseSettings(); // A saved game has its own
+            if (options.recordPath != NULL &&
+                !replayWriter.open(options.recordPath, game.mapWidth, game.mapHeight,
+                                   options.keyframeInterval, Engine::rules, options.seed, game.foodItems,
+                                   game.foodValues)) {
+                perror(options.recordPath);
+            }
+            runSession();
+        } else if (options.headless) {
+            benchmarkReplay();
+        } else {
+            playReplay();
+        }
+        if (!replayWriter.close()) {
+            perror(options.recordPath);
+        }
+
+        if (renderer != NULL) {
+            renderer->shutdown();
+            renderer->printStats(stderr);
+            if (options.threaded && gameSeconds > 0 && renderSeconds > 0) {
+                fprintf(stderr, "Game thread: %ld ticks, %.2f ticks/s\n", gameTicks, gameTicks / gameSeconds);
+                fprintf(stderr, "Render thread: %ld frames, %.2f frames/s, %ld stale boards skipped\n",
+                        renderer->stats.frames, renderer->stats.frames / renderSeconds, renderSkipped);
+            }
+            delete renderer;
+        }
+        if (bot != NULL) {
+            bot->printStats(stderr);
+            delete bot;
+        }
+
+        if (options.session && session.games > 0) {
+            fprintf(stderr, "Session: %ld games, best score %d, average %.1f, longest snake %d, %ld ticks in %.1f s\n",
+                    session.games, session.bestScore, (double)session.totalScore / session.games,
+                    session.longest, session.ticks, session.seconds);
+        }
+
+        if (eventLog.isOpen()) {
+            eventLog.close();
+            fprintf(stderr, "Events: %ld logged, %ld dropped\n", eventLog.logged, eventLog.dropped);
+        }
+
+        if (frameStream.isOpen() || frameStream.framesSent > 0) {
+            fprintf(stderr, "Stream: %ld frames sent, %ld dropped, %ld bytes\n",
+                    frameStream.framesSent, frameStream.framesDropped, frameStream.bytesSent);
+        }
+        return 0;
+    }
+
+private:
+    // Ask for difficulty level and wall option, unless given on the command
+    // line or this variant doesn't use them
+    void chooseSettings() {
+        if (options.difficulty == 0 && Engine::asksDifficulty && renderer != NULL) {
+            renderer->showMessage("Choose difficulty (1-9): ");
+            int diff = waitForKey() - '0'; // Convert char to int
+            if (diff >= 1 && diff <= 9) options.difficulty = diff;
+        }
+        if (options.walls < 0 && Engine::asksWalls && !game.hasLevel() && renderer != NULL) {
+            renderer->showMessage("Enable walls? (y/n): ");
+            int wallChoice = waitForKey();
+            options.walls = (wallChoice == 'y' || wallChoice == 'Y') ? 1 : 0;
+        }
+        if (options.difficulty != 0) game.difficulty = options.difficulty;
+        if (options.walls >= 0) game.wallsEnabled = options.walls != 0;
+    }
+
+    // Block until a key is pressed
+    int waitForKey() {
+        int ch;
+        while ((ch = renderer->readKey()) == NO_KEY) {
+            usleep(10000);
+        }
+        return ch;
+    }
+
+    // Play games until the session is over: one game, or with --session
+    // as many as the player wants, each restarting at once in the same
+    // terminal with the same buffers
+    void runSession() {
+        for (;;) {
+            bool quit = run();
+
+            // Display score before GAME OVER message
+            char message[256];
+            int length = snprintf(message, sizeof(message), "Score: %d\nGAME OVER!", game.score);
+            if (scoreLog.isOpen()) {
+                int best = recordScore(lastGameSeconds);
+                length += snprintf(message + length, sizeof(message) - length, "\nHigh score: %d", best);
+            }
+            if (!options.session) {
+                if (renderer == NULL) {
+                    printf("%s\n", message);
+                    return;
+                }
+                renderer->showMessage(message);
+                usleep(2000000); // Sleep for 2 seconds before exiting
+                return;
+            }
+
+            bool more = !quit && (options.sessionGames == 0 || session.games < options.sessionGames);
+            if (renderer == NULL) {
+                printf("Game %ld: score %d, length %d, %ld ticks\n", session.games, game.score, game.food, lastGameTicks);
+                if (!more) return;
+                continue;
+            }
+            snprintf(message + length, sizeof(message) - length,
+                     "\n\nGames: %ld  Best: %d  Average: %.1f\n\nPress r to play again, q to quit",
+                     session.games, session.bestScore, (double)session.totalScore / session.games);
+            renderer->showMessage(message);
+            if (!more) {
+                usleep(2000000);
+                return;
+            }
+            int ch;
+            while ((ch = waitForKey()) != 'r' && ch != 'q') {
+            }
+            if (ch == 'q') return;
+        }
+    }
+
+    // Play one game. Returns true if the player quit.
+    bool run() {
+        // Initialize the map (this also resets the length and score),
+        // unless carrying on with a saved game
+        if (!resumed) game.initMap();
+        resumed = false;
+        game.running = true;
+        uint64_t gameSeed = game.rngState; // --seed this to play the same game again
+        if (bot != NULL) bot->reset(gameSeed);
+        lastGameSeed = gameSeed;
+        bool quit = false;
+        if (eventLog.isOpen()) {
+            eventLog.log(EVENT_START, 0, game.mapWidth, game.mapHeight, game.difficulty, gameSeed);
+        }
+
+        // With a render thread, the game thread only simulates
+        std::thread renderThread;
+        if (options.threaded) {
+            renderStop = false;
+            renderThread = std::thread(&Driver::renderLoop, this);
+        }
+
+        const long tickNanos = game.tickMicros() * 1000L;
+        struct timespec start = monotonicNow();
+        struct timespec nextTick = start;
+        long ticks = 0;
+        bool timedOut = false;
+        while (game.running) {
+            struct timespec tickStart;
+            if (eventLog.isOpen()) tickStart = monotonicNow();
+
+            // A keyframe is the state the last tick left, before this tick's key turns the snake
+            if (replayWriter.isOpen() && replayWriter.wantsKeyframe()) {
+                game.captureState(ticks, replayState);
+                replayWriter.keyframe(replayState);
+            }
+
+            // If a key is pressed (the autopilot presses them when headless)
+            int ch = nextKey();
+            if (ch == 'q') {
+                quit = true;
+                break; // Quit
+            }
+            if (ch == 'S') {
+                saveGameNow();
+            } else if (ch != NO_KEY) {
+                int direction = game.direction;
+                game.changeDirection(ch);
+                if (game.direction != direction && eventLog.isOpen()) {
+                    eventLog.log(EVENT_TURN, ticks, game.headxpos, game.headypos, game.direction, 0);
+                }
+            }
+            if (replayWriter.isOpen()) {
+                replayWriter.input(game.direction);
+            }
+            int length = game.food;
+            game.update();
+            ++ticks;
+            if (game.food != length && eventLog.isOpen()) {
+                eventLog.log(EVENT_FOOD, ticks, game.headxpos, game.headypos, game.food, game.score);
+            }
+            if (options.threaded) {
+                // Hand the board to the render thread; it never holds us up
+                BoardSnapshot& snapshot = snapshots.writeBuffer();
+                snapshot.tick = ticks;
+                snapshot.score = game.score;
+                snapshot.length = game.food;
+                snapshot.cells.resize(game.mapSize); // Allocates only the first time round each slot
+                memcpy(&snapshot.cells[0], &game.map[0], game.mapSize * sizeof(int));
+                snapshots.publish();
+            } else if (renderer != NULL) {
+                printMap();
+            }
+            frameStream.publish(&game.map[0], getMapValue, game.score);
+            if (game.running && options.maxTicks > 0 && ticks >= options.maxTicks) {
+                game.running = false;
+                timedOut = true;
+            }
+            if (options.fast) {
+                continue;
+            }
+            if (options.threaded) {
+                // Sleep until the next tick is due, however long this one took
+                nextTick.tv_nsec += tickNanos;
+                while (nextTick.tv_nsec >= 1000000000L) {
+                    nextTick.tv_nsec -= 1000000000L;
+                    nextTick.tv_sec++;
+                }
+                if (eventLog.isOpen()) {
+                    struct timespec now = monotonicNow();
+                    long late = (now.tv_sec - nextTick.tv_sec) * 1000000000L + (now.tv_nsec - nextTick.tv_nsec);
+                    if (late > 0) eventLog.log(EVENT_OVERRUN, ticks, 0, 0, 0, late);
+                }
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextTick, NULL) == EINTR) {
+                }
+            } else {
+                if (eventLog.isOpen()) {
+                    long late = (long)(secondsSince(tickStart) * 1e9) - tickNanos;
+                    if (late > 0) eventLog.log(EVENT_OVERRUN, ticks, 0, 0, 0, late);
+                }
+                usleep(game.tickMicros()); // Sleep between ticks
+            }
+        }
+
+        if (eventLog.isOpen()) {
+            int cause = quit ? END_QUIT : timedOut ? END_TICKS : game.collision;
+            eventLog.log(EVENT_END, ticks, game.headxpos, game.headypos, cause, game.score);
+        }
+        lastGameTicks = ticks;
+        lastGameSeconds = secondsSince(start);
+        if (options.threaded) {
+            renderStop = true;
+            renderThread.join();
+            gameTicks += ticks;
+            gameSeconds += lastGameSeconds;
+        }
+
+        // Add the game to the session's totals
+        session.games++;
+        session.totalScore += game.score;
+        if (session.games == 1 || game.score > session.bestScore) session.bestScore = game.score;
+        if (game.food > session.longest) session.longest = game.food;
+        session.ticks += ticks;
+        session.seconds += lastGameSeconds;
+        return quit;
+    }
+
+    // Add the finished game to the high-score log. Returns the best score
+    // for this difficulty and wall setting.
+    int recordScore(double seconds) {
+        ScoreRecord record;
+        memset(&record, 0, sizeof(record));
+        record.score = game.score;
+        record.length = game.food;
+        record.difficulty = game.difficulty;
+        record.walls = Engine::Walls::hasWalls(game) || game.hasLevel();
+        record.rules = Engine::rules;
+        record.durationMillis = static_cast<uint32_t>(seconds * 1000);
+        record.seed = lastGameSeed;
+        record.playedAt = time(NULL);
+        if (!scoreLog.append(record)) {
+            perror(options.scoresPath);
+        }
+        std::vector<ScoreRecord> best;
+        scoreLog.board().top(game.difficulty, record.walls != 0, best);
+        return best.empty() ? game.score : best[0].score;
+    }
+
+    // Key for this tick, from the bot, the render thread or the terminal
+    int nextKey() {
+        int ch = NO_KEY;
+        if (renderer != NULL && options.threaded) {
+            if (!pressedKeys.pop(ch)) ch = NO_KEY;
+        } else if (renderer != NULL) {
+            ch = renderer->readKey();
+        }
+        if (bot != NULL && ch != 'q' && ch != 'S') {
+            ch = bot->play(game, Engine::Walls::wraps); // The player can only quit or save
+        }
+        return ch;
+    }
+
+    // Save the game as it stands to --save, and say so under the board
+    // unless the render thread owns the terminal
+    void saveGameNow() {
+        bool saved = saveGame(options.savePath, game, Engine::rules);
+        if (renderer != NULL && !options.threaded) {
+            char status[256];
+            snprintf(status, sizeof(status), saved ? "Saved to %s" : "Can't save to %s", options.savePath);
+            renderer->drawStatus(renderer->statusRow(game.mapHeight), status);
+        }
+    }
+
+    // Render thread: read keys and draw the newest board at its own pace.
+    // Boards published while it was busy are skipped.
+    void renderLoop() {
+        const long frameMicros = 1000000L / options.renderFps;
+        struct timespec start = monotonicNow();
+        long lastTick = 0;
+        long skipped = 0;
+        while (!renderStop) {
+            int ch;
+            while ((ch = renderer->readKey()) != NO_KEY) {
+                pressedKeys.push(ch);
+            }
+            if (snapshots.update()) {
+                const BoardSnapshot& snapshot = snapshots.readBuffer();
+                skipped += snapshot.tick - lastTick - 1;
+                lastTick = snapshot.tick;
+                renderer->draw(&snapshot.cells[0], game.mapWidth, game.mapHeight, getMapValue, snapshot.score, snapshot.length);
+            }
+            usleep(frameMicros);
+        }
+        renderSkipped = skipped;
+        renderSeconds = secondsSince(start);
+    }
+
+    // Print the map to the console
+    void printMap() {
+        renderer->draw(&game.map[0], game.mapWidth, game.mapHeight, getMapValue, game.score, game.food);
+    }
+
+    // Jump to a tick of the replay: load the keyframe before it and play the rest
+    void seekReplay(long tick) {
+        replayReader.keyframeBefore(tick, replayState);
+        game.restoreState(replayState);
+        for (long t = replayState.keyframe.tick; t < tick; ++t) {
+            game.direction = replayReader.inputAt(t);
+            game.update();
+        }
+    }
+
+    // Watch a replay. Space pauses, ',' and '.' step one tick, '[' and ']' jump
+    // 100 ticks, '{' and '}' jump a tenth of the replay, '0' and '$' go to the
+    // start and end, 'q' quits.
+    void playReplay() {
+        long total = replayReader.totalTicks();
+        long tick = options.startTick < 0 ? 0 : (options.startTick > total ? total : options.startTick);
+        seekReplay(tick);
+
+        bool paused = false;
+        double seekMicros = 0;
+        struct timespec lastStep = monotonicNow();
+        while (true) {
+            long target = tick;
+            int ch = renderer->readKey();
+            switch (ch) {
+                case 'q': return;
+                case ' ': paused = !paused; break;
+                case ',': target = tick - 1; break;
+                case '.': target = tick + 1; break;
+                case '[': target = tick - 100; break;
+                case ']': target = tick + 100; break;
+                case '{': target = tick - total / 10; break;
+                case '}': target = tick + total / 10; break;
+                case '0': target = 0; break;
+                case '$': target = total; break;
+            }
+            if (!paused && ch == NO_KEY && secondsSince(lastStep) * 1e6 >= game.tickMicros()) {
+                target = tick + 1;
+            }
+            if (target < 0) target = 0;
+            if (target > total) target = total;
+
+            if (target == tick + 1) {
+                // Playing forward needs no seek
+                game.direction = replayReader.inputAt(tick);
+                game.update();
+                tick = target;
+                lastStep = monotonicNow();
+            } else if (target != tick) {
+                struct timespec seekStart = monotonicNow();
+                seekReplay(target);
+                seekMicros = secondsSince(seekStart) * 1e6;
+                tick = target;
+                lastStep = monotonicNow();
+            }
+
+            char status[128];
+            snprintf(status, sizeof(status), "Tick %ld/%ld  %s  Last seek %.0f us",
+                     tick, total, paused ? "Paused" : "Playing", seekMicros);
+            printMap();
+            renderer->drawStatus(renderer->statusRow(game.mapHeight), status);
+            usleep(30000);
+        }
+    }
+
+    // Without a terminal: check the keyframes agree with re-simulation, then
+    // time random seeks
+    void benchmarkReplay() {
+        long total = replayReader.totalTicks();
+        long keyframes = replayReader.keyframeCount();
+        printf("Replay: %ld ticks, %ld keyframes every %d ticks\n", total, keyframes, replayReader.keyframeInterval());
+
+        // Simulating from each keyframe must land exactly on the next one
+        ReplayState expected;
+        long checked = 0;
+        for (long k = 1; k < keyframes && checked < 100; k += (keyframes + 99) / 100, ++checked) {
+            long tick = k * replayReader.keyframeInterval();
+            seekReplay(tick - 1);
+            game.direction = replayReader.inputAt(tick - 1);
+            game.update();
+            replayReader.keyframeBefore(tick, expected);
+            game.captureState(tick, replayState);
+            if (memcmp(&expected.keyframe, &replayState.keyframe, sizeof(ReplayKeyframe)) != 0 ||
+                expected.cells != replayState.cells) {
+                printf("Keyframe %ld does not match re-simulation\n", k);
+                return;
+            }
+        }
+        printf("Verified %ld keyframes against re-simulation\n", checked);
+
+        const int seeks = 1000;
+        double worst = 0;
+        struct timespec start = monotonicNow();
+        for (int i = 0; i < seeks; ++i) {
+            struct timespec seekStart = monotonicNow();
+            seekReplay(static_cast<long>(game.nextRandom() % (total + 1)));
+            double micros = secondsSince(seekStart) * 1e6;
+            if (micros > worst) worst = micros;
+        }
+        printf("%d random seeks: %.1f us average, %.1f us worst\n", seeks, secondsSince(start) * 1e6 / seeks, worst);
+    }
+
+    Options options;
+    Engine game;
+    LevelPack levelPack;
+    Renderer* renderer;          // Draws the game on the terminal (NULL when headless)
+    Bot* bot;                    // Plays instead of the player (NULL for a human)
+    FrameStream frameStream;     // Optional ANSI stream of every frame for spectators
+    EventLog eventLog;           // Optional log of what happened in each game (closed without --events)
+
+    // Replay recording and playback
+    ReplayWriter replayWriter;
+    ReplayReader replayReader;
+    ReplayState replayState;     // Reused when writing keyframes and seeking
+
+    ScoreLog scoreLog;           // Shared high-score log (closed without --scores)
+
+    // Hand-over between the game thread and the render thread
+    TripleBuffer<BoardSnapshot> snapshots;
+    SpscQueue<int, 64> pressedKeys; // Keys read by the render thread, in order
+    std::atomic<bool> renderStop;
+
+    bool resumed;                // The next game carries on from --resume
+
+    // Totals over every game of a --session
+    struct SessionStats {
+        long games;
+        long totalScore;
+        int bestScore;
+        int longest;
+        long ticks;
+        double seconds;
+    } session;
+
+    // The game that just ended
+    uint64_t lastGameSeed;
+    long lastGameTicks;
+    double lastGameSeconds;
+
+    // Rates reported on exit when running threaded
+    long gameTicks;
+    double gameSeconds;
+    long renderSkipped;
+    double renderSeconds;
+};
+
+// Entry point for a variant of the game
+template <class Engine>
+int runGame(int argc, char** argv) {
+    Driver<Engine> driver;
+    return driver.main(argc, argv);
+}
+
+#endif
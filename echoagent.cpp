@@ -0,0 +1,36 @@
+// Echo agent for the batched agent protocol (agentproto.h): answers every
+// observation with the direction the snake already has. It does no
+// thinking at all, so a run with it measures the cost of the protocol.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "agentproto.h"
+
+int main()
+{
+    const char keys[4] = {'w', 'd', 's', 'a'};
+    std::vector<char> frame;
+    std::vector<char> actions;
+    for (;;) {
+        AgentFrameHeader header;
+        if (!readFull(0, &header, sizeof(header))) return 0;
+        if (memcmp(header.magic, "SNKA", 4) != 0 || header.version != AGENT_PROTOCOL_VERSION) {
+            fprintf(stderr, "echoagent: not an agent frame\n");
+            return 1;
+        }
+        if (header.count == 0) return 0;
+
+        size_t observationSize = sizeof(AgentObservation) + header.width * header.height * sizeof(int32_t);
+        frame.resize(header.count * observationSize);
+        if (!readFull(0, &frame[0], frame.size())) return 1;
+
+        actions.resize(header.count);
+        for (uint32_t i = 0; i < header.count; ++i) {
+            AgentObservation observation;
+            memcpy(&observation, &frame[i * observationSize], sizeof(observation));
+            actions[i] = keys[observation.direction & 3];
+        }
+        if (!writeFull(1, &actions[0], actions.size())) return 1;
+    }
+}
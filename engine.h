@@ -0,0 +1,242 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#ifdef CHECK_HASH
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+#include "game.h"
+
+// Rule policies. The snake*.cpp variants differ only in which of these they
+// combine; every policy call is resolved at compile time, so moveSnake()
+// carries no checks for rules a variant doesn't have.
+
+// Walls on the edges in every game. Leaving the map is a collision.
+struct FixedWalls {
+    static const int id = 0;
+    static const bool optional = false; // Player can't turn them off
+    static const bool wraps = false;
+    static bool hasWalls(const Game&) { return true; }
+    static bool enter(const Game& game, int& x, int& y) {
+        return x >= 0 && x < game.mapWidth && y >= 0 && y < game.mapHeight;
+    }
+};
+
+// Walls the player can turn off. Leaving the map is still a collision.
+struct OptionalWalls {
+    static const int id = 1;
+    static const bool optional = true;
+    static const bool wraps = false;
+    static bool hasWalls(const Game& game) { return game.wallsEnabled; }
+    static bool enter(const Game& game, int& x, int& y) {
+        return x >= 0 && x < game.mapWidth && y >= 0 && y < game.mapHeight;
+    }
+};
+
+// Walls the player can turn off; without them the snake wraps around the
+// screen. With walls on the snake never reaches the edge, so wrapping
+// unconditionally is the same as checking wallsEnabled.
+struct WrapWalls {
+    static const int id = 2;
+    static const bool optional = true;
+    static const bool wraps = true;
+    static bool hasWalls(const Game& game) { return game.wallsEnabled; }
+    static bool enter(const Game& game, int& x, int& y) {
+        if (x < 0) x = game.mapWidth - 1;
+        if (x >= game.mapWidth) x = 0;
+        if (y < 0) y = game.mapHeight - 1;
+        if (y >= game.mapHeight) y = 0;
+        return true;
+    }
+};
+
+// Running into anything ends the game
+struct DieOnCollision {
+    static const int id = 0;
+    static bool waiting(Game&) { return false; }
+    static void collide(Game& game) { game.running = false; }
+};
+
+// Running into something makes the snake stay still for one loop instead
+struct ForgiveCollision {
+    static const int id = 1;
+    // If snake is in forgiveness state, don't move and wait for the next loop
+    static bool waiting(Game& game) {
+        if (!game.isInForgivenessState) return false;
+        game.forgivenessCount--;
+        if (game.forgivenessCount <= 0) {
+            game.isInForgivenessState = false;  // Reset forgiveness state after one loop
+        }
+        return true;
+    }
+    static void collide(Game& game) {
+        game.isInForgivenessState = true;  // Activate forgiveness state
+        game.forgivenessCount = 1;  // Snake will stay still for 1 loop
+    }
+};
+
+// 10 points per food
+struct FlatScoring {
+    static const int id = 0;
+    static const bool usesDifficulty = false;
+    static int points(const Game&) { return 10; }
+};
+
+// 10 times the difficulty level per food
+struct DifficultyScoring {
+    static const int id = 1;
+    static const bool usesDifficulty = true;
+    static int points(const Game& game) { return 10 * game.difficulty; }
+};
+
+// A tick every 300 milliseconds
+struct FixedSpeed {
+    static const int id = 0;
+    static const bool usesDifficulty = false;
+    static long tickMicros(const Game&) { return 300000; }
+};
+
+// Speed based on the difficulty level
+struct DifficultySpeed {
+    static const int id = 1;
+    static const bool usesDifficulty = true;
+    static long tickMicros(const Game& game) { return 1000000 / game.difficulty; }
+};
+
+// A game played under one combination of rules
+template <class WallPolicy, class CollisionPolicy, class ScoringPolicy, class SpeedPolicy>
+class Engine : public Game {
+public:
+    typedef WallPolicy Walls;
+    typedef CollisionPolicy Collision;
+    typedef ScoringPolicy Scoring;
+    typedef SpeedPolicy Speed;
+
+    // Identifies the rule set, for example in replays
+    static const unsigned int rules =
+        Walls::id | (Collision::id << 4) | (Scoring::id << 8) | (Speed::id << 12);
+
+    // Whether the player picks a difficulty or the walls before playing
+    static const bool asksDifficulty = Scoring::usesDifficulty || Speed::usesDifficulty;
+    static const bool asksWalls = Walls::optional;
+
+    // Initialize the map
+    void initMap() {
+        // Initialize position of snake head
+        headxpos = spawnx;
+        headypos = spawny;
+        direction = spawnDirection;
+        // Start over: a finished game leaves its length, score and forgiveness behind
+        food = START_LENGTH;
+        score = 0;
+        isInForgivenessState = false;
+        forgivenessCount = 0;
+        collision = COLLIDE_NONE;
+        // Fill the map, with the level's walls if there is one
+        if (hasLevel()) {
+            map = levelMap;
+        } else {
+            for (int i = 0; i < mapSize; ++i) {
+                map[i] = 0;
+            }
+        }
+        // Set the head position
+        map[headypos * mapWidth + headxpos] = food;
+
+        // Place the walls on the edges if enabled (a level brings its own)
+        if (Walls::hasWalls(*this) && !hasLevel()) {
+            placeWalls();
+        }
+        rehash();
+
+        // Place the first pieces of food
+        placeFood();
+    }
+
+    // Move the snake in the given direction
+    void moveSnake(int dx, int dy) {
+        if (Collision::waiting(*this)) {
+            return;  // Return early to skip moving the snake
+        }
+
+        int newx = headxpos + dx;
+        int newy = headypos + dy;
+
+        // Check if the snake leaves the map or hits a wall
+        if (!Walls::enter(*this, newx, newy)) {
+            collision = COLLIDE_EDGE;
+            Collision::collide(*this);
+            return;
+        }
+        if (map[newy * mapWidth + newx] == WALL) {
+            collision = COLLIDE_WALL;
+            Collision::collide(*this);
+            return;
+        }
+
+        // Check if the snake hits itself
+        if (map[newy * mapWidth + newx] > 0) {
+            collision = COLLIDE_BODY;
+            Collision::collide(*this);
+            return;
+        }
+
+        // Check if the snake eats the food
+        int cell = newy * mapWidth + newx;
+        if (isFood(map[cell])) {
+            food++;
+            headPower = gfTimesX(headPower);
+            score += Scoring::points(*this) * foodValue(map[cell]);
+            foodHash ^= foodKey(cell, map[cell]);
+            if (multiFood()) foodField.removeFood(cell);
+            generateFood(); // Generate new food
+        } else if (multiFood()) {
+            // Move the snake body, handing back the cell the tail leaves
+            ageBody();
+            for (int i = 0; i < mapSize; ++i) {
+                if (map[i] > 0 && --map[i] == 0) foodField.release(i);
+            }
+            foodField.occupy(cell);
+        } else {
+            // Move the snake body
+            ageBody();
+            for (int i = 0; i < mapSize; ++i) {
+                if (map[i] > 0) map[i]--;
+            }
+        }
+
+        // Move the snake head
+        headxpos = newx;
+        headypos = newy;
+
+        // Set new head position
+        map[cell] = food;
+        bodyHash ^= bodyKey(cell, headPower);
+    }
+
+    // Update the game state
+    void update() {
+        switch (direction) {
+            case 0: moveSnake(0, -1); break;
+            case 1: moveSnake(1, 0); break;
+            case 2: moveSnake(0, 1); break;
+            case 3: moveSnake(-1, 0); break;
+        }
+#ifdef CHECK_HASH
+        if (stateHash() != fullHash()) {
+            fprintf(stderr, "Position hash %016llx, worked out from the map %016llx\n",
+                    (unsigned long long)stateHash(), (unsigned long long)fullHash());
+            abort();
+        }
+#endif
+    }
+
+    // How long to wait between ticks
+    long tickMicros() const { return Speed::tickMicros(*this); }
+
+    // Key the autopilot would press now
+    int autopilot() const { return autopilotKey(*this, Walls::wraps); }
+};
+
+#endif
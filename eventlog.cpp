@@ -0,0 +1,84 @@
+#include "eventlog.h"
+
+#include <unistd.h>
+
+#include "game.h"
+
+static_assert(sizeof(Event) == 24, "an event is copied whole into the ring");
+static_assert(END_QUIT == COLLIDE_BODY + 1, "the ways a game ends carry on from the collisions");
+
+EventLog::EventLog() : logged(0), dropped(0), file(NULL), stop(false) {
+}
+
+EventLog::~EventLog() {
+    close();
+}
+
+bool EventLog::open(const char* path) {
+    close();
+    file = fopen(path, "w");
+    if (file == NULL) return false;
+    logged = 0;
+    dropped = 0;
+    stop = false;
+    writer = std::thread(&EventLog::writeEvents, this);
+    return true;
+}
+
+void EventLog::close() {
+    if (file == NULL) return;
+    stop = true;
+    writer.join();
+    if (dropped > 0) {
+        fprintf(file, "%ld events dropped, the ring was full\n", dropped);
+    }
+    fclose(file);
+    file = NULL;
+}
+
+void EventLog::writeEvents() {
+    Event event;
+    for (;;) {
+        // Read stop before draining, so nothing pushed before it was set is missed
+        bool last = stop;
+        bool any = false;
+        while (ring.pop(event)) {
+            format(event);
+            any = true;
+        }
+        if (last) break;
+        if (!any) {
+            fflush(file);
+            usleep(1000); // Poll; waking the writer would cost the game thread a system call
+        }
+    }
+    fflush(file);
+}
+
+void EventLog::format(const Event& event) {
+    static const char* const directions[4] = {"up", "right", "down", "left"};
+    static const char* const causes[6] = {"none", "edge", "wall", "body", "quit", "ticks"};
+    switch (event.type) {
+        case EVENT_START:
+            fprintf(file, "%u start size %ux%u difficulty %u seed %llu\n", event.tick, event.x, event.y,
+                    event.detail, (unsigned long long)event.value);
+            break;
+        case EVENT_FOOD:
+            fprintf(file, "%u food %u,%u length %u score %llu\n", event.tick, event.x, event.y, event.detail,
+                    (unsigned long long)event.value);
+            break;
+        case EVENT_TURN:
+            fprintf(file, "%u turn %u,%u %s\n", event.tick, event.x, event.y, directions[event.detail & 3]);
+            break;
+        case EVENT_END:
+            fprintf(file, "%u end %u,%u %s score %llu\n", event.tick, event.x, event.y,
+                    event.detail <= END_TICKS ? causes[event.detail] : "?", (unsigned long long)event.value);
+            break;
+        case EVENT_OVERRUN:
+            fprintf(file, "%u overrun %.3f ms\n", event.tick, event.value / 1e6);
+            break;
+        default:
+            fprintf(file, "%u unknown event %u\n", event.tick, event.type);
+            break;
+    }
+}
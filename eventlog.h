@@ -0,0 +1,87 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "spscqueue.h"
+
+// What happened (Event::type)
+const int EVENT_START = 0;   // A game started: x, y the map size, detail the difficulty, value the seed
+const int EVENT_FOOD = 1;    // Food eaten at x, y: detail the new length, value the score
+const int EVENT_TURN = 2;    // The snake turned at x, y: detail the new direction
+const int EVENT_END = 3;     // The game ended with the head at x, y: detail why, value the score
+const int EVENT_OVERRUN = 4; // A tick ran past its time: value the nanoseconds late
+
+// Why a game ended (Event::detail of EVENT_END): a COLLIDE_* value, or
+const int END_QUIT = 4;
+const int END_TICKS = 5;     // --ticks reached
+
+// One event as the game thread records it, 24 bytes with no pointers, so
+// logging is a copy into the ring
+struct Event {
+    uint64_t value;
+    uint32_t tick;
+    uint32_t detail;
+    uint16_t x;
+    uint16_t y;
+    uint8_t type;
+    uint8_t reserved[3];
+};
+
+// Writes game events to a file as text, one line each, without the game
+// thread waiting for the disk or formatting anything: log() copies the
+// event into a fixed ring and a background thread takes them out, formats
+// and writes them. When the ring is full the event is dropped and counted
+// instead of waiting.
+class EventLog {
+public:
+    EventLog();
+    ~EventLog();
+
+    // Start writing to path (truncated) and start the writer thread
+    bool open(const char* path);
+
+    // Write what is left in the ring and stop the writer thread
+    void close();
+
+    bool isOpen() const { return file != NULL; }
+
+    // Record an event. Only ever called from one thread, the game's.
+    void log(int type, long tick, int x, int y, int detail, uint64_t value) {
+        Event event;
+        event.value = value;
+        event.tick = static_cast<uint32_t>(tick);
+        event.x = static_cast<uint16_t>(x);
+        event.y = static_cast<uint16_t>(y);
+        event.type = static_cast<uint8_t>(type);
+        event.detail = static_cast<uint32_t>(detail);
+        if (ring.push(event)) {
+            logged++;
+        } else {
+            dropped++;
+        }
+    }
+
+    // Statistics, kept by the game thread
+    long logged;
+    long dropped;
+
+private:
+    // Writer thread: empty the ring until told to stop, then once more
+    void writeEvents();
+
+    // Write one event as a line of text
+    void format(const Event& event);
+
+    static const size_t RING_EVENTS = 4096;
+
+    SpscQueue<Event, RING_EVENTS> ring;
+    FILE* file;
+    std::atomic<bool> stop;
+    std::thread writer;
+};
+
+#endif
@@ -0,0 +1,449 @@
+// Neuroevolution: breeds a population of policy networks (policynet.h) by
+// playing each of them in headless games, in parallel across all cores,
+// keeping and recombining the best and mutating the rest.
+//
+//   ./evolve --generations 200 --rules snake2 -o evolve
+//   ./snake2 --bot net:evolve.net
+//
+// Every generation plays all its networks on the same seeds, drawn from
+// --seed, and everything random in breeding comes from one generator
+// seeded with --seed, used on one thread. So a run is the same however
+// many threads play it, and resuming from a checkpoint carries on exactly
+// as if it hadn't stopped: the checkpoint holds every setting that shapes
+// the run, and --resume takes them from it over the command line.
+//
+// .ckpt layout (native byte order):
+//
+//   EvolveHeader
+//   PolicyNet population[population]   the generation to play next
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "policynet.h"
+#include "timing.h"
+#include "variants.h"
+
+using namespace std;
+
+struct EvolveHeader {
+    char magic[4];         // "SNKE"
+    uint32_t version;
+    uint32_t params;       // NET_PARAMS
+    uint32_t population;
+    uint32_t generation;   // Generations played so far
+    uint32_t rules;        // Engine::rules it was bred under
+    uint64_t seed;         // --seed of the run
+    uint64_t rngState;     // Breeding generator, as it is for the next generation
+    // The settings the run was started with
+    int64_t maxTicks;
+    int64_t starveTicks;
+    double mutationRate;
+    double mutationSize;
+    uint32_t gamesPerNet;
+    uint32_t elites;
+    uint32_t tournamentSize;
+    int32_t difficulty;
+    int32_t wallsEnabled;
+    int32_t mapWidth;
+    int32_t mapHeight;
+    uint32_t reserved;
+};
+
+const uint32_t EVOLVE_VERSION = 3; // 1 stored w2 by hidden unit, 2 had no settings
+
+// Settings
+int population = 256;
+int generations = 100;
+int gamesPerNet = 4;        // Games each network plays per generation
+uint64_t runSeed = 1;
+int threads = 0;            // 0 = one per core
+long maxTicks = 5000;       // Tick limit per game
+long starveTicks = 0;       // Ticks without food before a game is called off (0 = map size)
+int difficulty = 5;
+bool wallsEnabled = true;
+int mapWidth = 0;           // 0 = default size
+int mapHeight = 0;
+int elites = 8;             // Best networks copied unchanged
+int tournamentSize = 3;     // Networks compared to pick each parent
+double mutationRate = 0.05; // Chance of mutating each weight
+double mutationSize = 0.3;  // Standard deviation of a mutation
+int checkpointEvery = 10;   // Generations between checkpoints
+const char* outPrefix = "evolve";
+const char* resumePath = NULL;
+
+// How one network did in a generation
+struct Fitness {
+    double value;  // Food eaten, plus a little for staying alive
+    long eaten;
+    long ticks;
+};
+
+// The breeding generator (xorshift64*, like the game's)
+struct Random {
+    uint64_t state;
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dULL;
+    }
+
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    int below(int n) { return (next() >> 32) % n; }
+
+    // Normally distributed (Box-Muller)
+    double gaussian() {
+        double u = 1.0 - uniform();
+        return sqrt(-2.0 * log(u)) * cos(2 * M_PI * uniform());
+    }
+};
+
+// Seed of game k of a generation: the same for every network in it
+static uint64_t gameSeed(int generation, int k) {
+    uint64_t x = runSeed * 0x9e3779b97f4a7c15ULL + (uint64_t)generation * gamesPerNet + k + 1;
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 29;
+    return x;
+}
+
+// Play one network on every game of a generation. The games go in
+// lockstep, so each tick the network is run on all of them in one batch.
+template <class Engine>
+Fitness playNet(const PolicyNet& net, int generation) {
+    static const char keys[4] = {'w', 'd', 's', 'a'};
+    vector<Engine> games(gamesPerNet);
+    vector<long> lastMeal(gamesPerNet, 0);
+    vector<int> length(gamesPerNet);
+    vector<int> live(gamesPerNet);  // Games still going, in order
+    vector<float> features(gamesPerNet * NET_INPUTS);
+    vector<float> outputs(gamesPerNet * NET_OUTPUTS);
+    Fitness fitness = {0, 0, 0};
+    for (int k = 0; k < gamesPerNet; ++k) {
+        Engine& game = games[k];
+        if (mapWidth > 0) {
+            game.resize(mapWidth, mapHeight);
+        }
+        game.seed(gameSeed(generation, k));
+        game.difficulty = difficulty;
+        game.wallsEnabled = wallsEnabled;
+        game.initMap();
+        game.running = true;
+        length[k] = game.food;
+        live[k] = k;
+    }
+    long starve = starveTicks > 0 ? starveTicks : games[0].mapSize;
+    int count = gamesPerNet;
+    for (long ticks = 0; count > 0; ) {
+        for (int j = 0; j < count; ++j) {
+            netFeatures(games[live[j]], Engine::Walls::wraps, &features[j * NET_INPUTS]);
+        }
+        netForward(net, &features[0], &outputs[0], count);
+        ++ticks;
+        int still = 0;
+        for (int j = 0; j < count; ++j) {
+            int k = live[j];
+            Engine& game = games[k];
+            game.changeDirection(keys[netChoice(&outputs[j * NET_OUTPUTS], game.direction)]);
+            game.update();
+            if (game.food != length[k]) {
+                length[k] = game.food;
+                lastMeal[k] = ticks;
+            }
+            // Networks that only go round in circles are stopped by starvation
+            if (game.running && ticks < maxTicks && ticks - lastMeal[k] < starve) {
+                live[still++] = k;
+                continue;
+            }
+            long eaten = game.food - START_LENGTH;
+            fitness.value += eaten + ticks * 0.0001;
+            fitness.eaten += eaten;
+            fitness.ticks += ticks;
+        }
+        count = still;
+    }
+    return fitness;
+}
+
+// Worker thread: take networks until there are none left
+template <class Engine>
+void playNets(const vector<PolicyNet>& nets, int generation, atomic<int>& next, vector<Fitness>& results) {
+    for (int i = next++; i < (int)nets.size(); i = next++) {
+        results[i] = playNet<Engine>(nets[i], generation);
+    }
+}
+
+// Pick a parent: the fittest of a few taken at random
+static int pickParent(Random& random, const vector<Fitness>& results) {
+    int best = random.below(results.size());
+    for (int t = 1; t < tournamentSize; ++t) {
+        int other = random.below(results.size());
+        if (results[other].value > results[best].value) best = other;
+    }
+    return best;
+}
+
+// The next generation: the elites as they are, then children of two
+// parents, each weight from one or the other, some of them mutated
+static vector<PolicyNet> breed(Random& random, const vector<PolicyNet>& nets,
+                               const vector<Fitness>& results, const vector<int>& ranking) {
+    vector<PolicyNet> children(nets.size());
+    int kept = min(elites, (int)nets.size());
+    for (int i = 0; i < kept; ++i) {
+        children[i] = nets[ranking[i]];
+    }
+    for (size_t i = kept; i < nets.size(); ++i) {
+        const float* a = reinterpret_cast<const float*>(&nets[pickParent(random, results)]);
+        const float* b = reinterpret_cast<const float*>(&nets[pickParent(random, results)]);
+        float* child = reinterpret_cast<float*>(&children[i]);
+        for (int p = 0; p < NET_PARAMS; ++p) {
+            child[p] = random.next() >> 63 ? a[p] : b[p];
+            if (random.uniform() < mutationRate) {
+                child[p] += mutationSize * random.gaussian();
+            }
+        }
+    }
+    return children;
+}
+
+// Write the population to play next, replacing the file in one step
+static bool saveCheckpoint(const char* path, const vector<PolicyNet>& nets, int generation,
+                           uint32_t rules, const Random& random) {
+    EvolveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKE", 4);
+    header.version = EVOLVE_VERSION;
+    header.params = NET_PARAMS;
+    header.population = nets.size();
+    header.generation = generation;
+    header.rules = rules;
+    header.seed = runSeed;
+    header.rngState = random.state;
+    header.maxTicks = maxTicks;
+    header.starveTicks = starveTicks;
+    header.mutationRate = mutationRate;
+    header.mutationSize = mutationSize;
+    header.gamesPerNet = gamesPerNet;
+    header.elites = elites;
+    header.tournamentSize = tournamentSize;
+    header.difficulty = difficulty;
+    header.wallsEnabled = wallsEnabled;
+    header.mapWidth = mapWidth;
+    header.mapHeight = mapHeight;
+
+    string temp = string(path) + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    string file(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.append(reinterpret_cast<const char*>(nets.data()), nets.size() * sizeof(PolicyNet));
+    bool ok = write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size()) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok && rename(temp.c_str(), path) == 0) return true;
+    unlink(temp.c_str());
+    return false;
+}
+
+// Read a checkpoint written under the same rules. Prints why and returns false if it can't.
+static bool loadCheckpoint(const char* path, vector<PolicyNet>& nets, int& generation,
+                           uint32_t rules, Random& random) {
+    FILE* in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return false;
+    }
+    EvolveHeader header;
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, "SNKE", 4) == 0 &&
+              header.version == EVOLVE_VERSION && header.params == NET_PARAMS && header.population > 0 &&
+              header.gamesPerNet >= 1 && header.tournamentSize >= 1 &&
+              (header.mapWidth == 0 || (header.mapWidth >= 3 && header.mapHeight >= 3));
+    if (ok) {
+        nets.resize(header.population);
+        ok = fread(nets.data(), sizeof(PolicyNet), nets.size(), in) == nets.size();
+    }
+    fclose(in);
+    if (!ok) {
+        fprintf(stderr, "%s: not a checkpoint\n", path);
+        return false;
+    }
+    if (header.rules != rules) {
+        fprintf(stderr, "%s: bred under other rules\n", path);
+        return false;
+    }
+    generation = header.generation;
+    runSeed = header.seed;
+    random.state = header.rngState;
+    maxTicks = header.maxTicks;
+    starveTicks = header.starveTicks;
+    mutationRate = header.mutationRate;
+    mutationSize = header.mutationSize;
+    gamesPerNet = header.gamesPerNet;
+    elites = header.elites;
+    tournamentSize = header.tournamentSize;
+    difficulty = header.difficulty;
+    wallsEnabled = header.wallsEnabled != 0;
+    mapWidth = header.mapWidth;
+    mapHeight = header.mapHeight;
+    return true;
+}
+
+// Breed for the given number of generations under one rule set
+template <class Engine>
+int evolve() {
+    string checkpointPath = string(outPrefix) + ".ckpt";
+    string netPath = string(outPrefix) + ".net";
+    vector<PolicyNet> nets;
+    Random random;
+    int generation = 0;
+    if (resumePath != NULL) {
+        if (!loadCheckpoint(resumePath, nets, generation, Engine::rules, random)) return 1;
+        population = nets.size();
+        printf("Resuming at generation %d with %d networks, seed %llu and the checkpoint's settings\n",
+               generation, population, (unsigned long long)runSeed);
+    } else {
+        // Small random weights to start
+        random.state = runSeed * 0x9e3779b97f4a7c15ULL + 1;
+        nets.resize(population);
+        for (int i = 0; i < population; ++i) {
+            float* weights = reinterpret_cast<float*>(&nets[i]);
+            for (int p = 0; p < NET_PARAMS; ++p) {
+                weights[p] = 0.5 * random.gaussian();
+            }
+        }
+    }
+
+    printf("%5s %10s %10s %10s %10s %8s\n", "gen", "best", "mean", "eaten", "ticks", "seconds");
+    int last = generation + generations;
+    long totalTicks = 0;
+    struct timespec start = monotonicNow();
+    while (generation < last) {
+        struct timespec generationStart = monotonicNow();
+        vector<Fitness> results(nets.size());
+        atomic<int> next(0);
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.push_back(thread(playNets<Engine>, cref(nets), generation, ref(next), ref(results)));
+        }
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+
+        // Fittest first; ties go to the lower index, so the order is the same every run
+        vector<int> ranking(nets.size());
+        double sum = 0;
+        long ticks = 0;
+        for (size_t i = 0; i < nets.size(); ++i) {
+            ranking[i] = i;
+            sum += results[i].value;
+            ticks += results[i].ticks;
+        }
+        stable_sort(ranking.begin(), ranking.end(),
+                    [&results](int a, int b) { return results[a].value > results[b].value; });
+        const Fitness& best = results[ranking[0]];
+        totalTicks += ticks;
+        printf("%5d %10.2f %10.2f %10.2f %10.0f %8.2f\n", generation + 1, best.value / gamesPerNet,
+               sum / nets.size() / gamesPerNet, (double)best.eaten / gamesPerNet,
+               (double)best.ticks / gamesPerNet, secondsSince(generationStart));
+        fflush(stdout);
+
+        PolicyNet champion = nets[ranking[0]];
+        nets = breed(random, nets, results, ranking);
+        ++generation;
+        if (generation % checkpointEvery == 0 || generation == last) {
+            if (!saveNet(netPath.c_str(), champion) ||
+                !saveCheckpoint(checkpointPath.c_str(), nets, generation, Engine::rules, random)) {
+                perror(outPrefix);
+                return 1;
+            }
+        }
+    }
+    double seconds = secondsSince(start);
+    printf("%d generations of %d networks in %.2f s on %d threads: %.1f generations/min, %.0f steps/s\n",
+           generations, (int)nets.size(), seconds, threads, generations * 60 / seconds, totalTicks / seconds);
+    printf("Best network of the last generation in %s, population in %s\n",
+           netPath.c_str(), checkpointPath.c_str());
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rules = "snake2";
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--population") == 0 && hasValue) {
+            population = atoi(argv[++i]);
+            ok = population >= 2;
+        } else if (strcmp(argv[i], "--generations") == 0 && hasValue) {
+            generations = atoi(argv[++i]);
+            ok = generations >= 1;
+        } else if (strcmp(argv[i], "--games") == 0 && hasValue) {
+            gamesPerNet = atoi(argv[++i]);
+            ok = gamesPerNet >= 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            runSeed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rules") == 0 && hasValue) {
+            rules = argv[++i];
+        } else if (strcmp(argv[i], "--ticks") == 0 && hasValue) {
+            maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--starve") == 0 && hasValue) {
+            starveTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--difficulty") == 0 && hasValue) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && hasValue) {
+            wallsEnabled = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+            ok = sscanf(argv[++i], "%dx%d", &mapWidth, &mapHeight) == 2 && mapWidth >= 3 && mapHeight >= 3;
+        } else if (strcmp(argv[i], "--elites") == 0 && hasValue) {
+            elites = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mutation-rate") == 0 && hasValue) {
+            mutationRate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mutation-size") == 0 && hasValue) {
+            mutationSize = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint-every") == 0 && hasValue) {
+            checkpointEvery = atoi(argv[++i]);
+            ok = checkpointEvery >= 1;
+        } else if (strcmp(argv[i], "--resume") == 0 && hasValue) {
+            resumePath = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && hasValue) {
+            outPrefix = argv[++i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Usage: %s [--population N] [--generations N] [--games N] [--seed N] [--threads N]\n"
+                        "       [--rules snake|snake2..snake7] [--ticks N] [--starve N] [--difficulty 1-9]\n"
+                        "       [--walls y|n] [--size WxH] [--elites N] [--mutation-rate P] [--mutation-size S]\n"
+                        "       [--checkpoint-every N] [--resume FILE.ckpt] [-o PREFIX]\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) {
+        threads = thread::hardware_concurrency();
+        if (threads < 1) threads = 1;
+    }
+
+    if (strcmp(rules, "snake") == 0) return evolve<SnakeEngine>();
+    if (strcmp(rules, "snake2") == 0) return evolve<Snake2Engine>();
+    if (strcmp(rules, "snake3") == 0) return evolve<Snake3Engine>();
+    if (strcmp(rules, "snake4") == 0) return evolve<Snake4Engine>();
+    if (strcmp(rules, "snake5") == 0) return evolve<Snake5Engine>();
+    if (strcmp(rules, "snake6") == 0) return evolve<Snake6Engine>();
+    if (strcmp(rules, "snake7") == 0) return evolve<Snake7Engine>();
+    fprintf(stderr, "Unknown rules: %s\n", rules);
+    return 1;
+}
@@ -0,0 +1,67 @@
+// Fixture maker: writes a saved game with a long snake already in place, so
+// benchmarks can start from a crowded board instead of playing up to one.
+//
+//   ./fixture --length 700 --size 40x20 [--walls y|n] [--seed N] -o coil700.sav
+//
+// The snake is coiled row by row from the bottom left (see coilSnake). The
+// file is saved as a fixture, which loads under any rules.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "savegame.h"
+#include "variants.h"
+
+int main(int argc, char** argv) {
+    int length = 0;
+    int width = 0;
+    int height = 0;
+    bool walls = false;
+    int difficulty = 5;
+    unsigned long long seed = 1;
+    const char* out = NULL;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--length") == 0 && hasValue) {
+            length = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 3 || height < 3 ||
+                width > 4096 || height > 4096) {
+                fprintf(stderr, "Size must be WIDTHxHEIGHT, 3x3 to 4096x4096\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--walls") == 0 && hasValue) {
+            walls = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--difficulty") == 0 && hasValue) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && hasValue) {
+            out = argv[++i];
+        } else {
+            out = NULL;
+            break;
+        }
+    }
+    if (out == NULL || length < 2 || difficulty < 1 || difficulty > 9) {
+        fprintf(stderr, "Usage: %s --length N [--size WxH] [--walls y|n] [--difficulty 1-9] [--seed N] -o FILE\n", argv[0]);
+        return 1;
+    }
+
+    // Optional walls, so --walls decides
+    Snake3Engine game;
+    if (width > 0) game.resize(width, height);
+    game.seed(seed);
+    game.difficulty = difficulty;
+    game.wallsEnabled = walls;
+    game.initMap();
+    if (!coilSnake(game, length)) {
+        fprintf(stderr, "A snake of length %d doesn't fit on a %dx%d board\n", length, game.mapWidth, game.mapHeight);
+        return 1;
+    }
+    if (!saveGame(out, game, FIXTURE_RULES)) {
+        perror(out);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "foodfield.h"
+
+#include <cstdlib>
+
+#include "game.h"
+
+FoodField::FoodField()
+    : width(0), height(0), bucketsWide(0), bucketsHigh(0), foods(0), freeTotal(0), freeTop(0) {
+}
+
+void FoodField::build(const std::vector<int>& map, int width, int height) {
+    this->width = width;
+    this->height = height;
+    bucketsWide = (width + BUCKET - 1) / BUCKET;
+    bucketsHigh = (height + BUCKET - 1) / BUCKET;
+    foods = 0;
+
+    int size = width * height;
+    isFree.assign(size, 0);
+    freeTree.assign(size + 1, 0);
+    freeTotal = 0;
+    freeTop = 1;
+    while (freeTop * 2 <= size) freeTop *= 2;
+    buckets.resize(bucketsWide * bucketsHigh);
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        buckets[b].clear();
+    }
+    bucketSlot.assign(size, -1);
+
+    for (int i = 0; i < size; ++i) {
+        if (map[i] == EMPTY) {
+            isFree[i] = 1;
+            ++freeTotal;
+            freeTree[i + 1]++;
+        } else if (isFood(map[i])) {
+            addFood(i);
+        }
+    }
+    // Build the tree in one pass: each node adds itself to its parent
+    for (int i = 1; i <= size; ++i) {
+        int parent = i + (i & -i);
+        if (parent <= size) freeTree[parent] += freeTree[i];
+    }
+}
+
+void FoodField::countFree(int cell, int change) {
+    for (int i = cell + 1; i < (int)freeTree.size(); i += i & -i) {
+        freeTree[i] += change;
+    }
+    freeTotal += change;
+}
+
+void FoodField::occupy(int cell) {
+    if (!isFree[cell]) return;
+    isFree[cell] = 0;
+    countFree(cell, -1);
+}
+
+void FoodField::release(int cell) {
+    if (isFree[cell]) return;
+    isFree[cell] = 1;
+    countFree(cell, 1);
+}
+
+int FoodField::freeCell(int n) const {
+    // Walk down the tree, skipping every block with n or fewer empty cells
+    int pos = 0;
+    for (int step = freeTop; step > 0; step /= 2) {
+        if (pos + step < (int)freeTree.size() && freeTree[pos + step] <= n) {
+            pos += step;
+            n -= freeTree[pos];
+        }
+    }
+    return pos;
+}
+
+int FoodField::bucketOf(int cell) const {
+    return (cell / width / BUCKET) * bucketsWide + (cell % width) / BUCKET;
+}
+
+void FoodField::addFood(int cell) {
+    std::vector<int>& bucket = buckets[bucketOf(cell)];
+    bucketSlot[cell] = bucket.size();
+    bucket.push_back(cell);
+    ++foods;
+}
+
+void FoodField::removeFood(int cell) {
+    // Move the last food in the bucket into the hole
+    std::vector<int>& bucket = buckets[bucketOf(cell)];
+    int slot = bucketSlot[cell];
+    if (slot < 0) return;
+    int last = bucket.back();
+    bucket[slot] = last;
+    bucketSlot[last] = slot;
+    bucket.pop_back();
+    bucketSlot[cell] = -1;
+    --foods;
+}
+
+int FoodField::nearest(int x, int y, bool wraps) const {
+    if (foods == 0) return -1;
+
+    int bx = x / BUCKET;
+    int by = y / BUCKET;
+    int best = -1;
+    int bestDistance = width + height;
+
+    // Look at rings of buckets around the head's bucket. Every cell in ring r
+    // is at least (r - 1) * BUCKET + 1 moves away, so stop once that can't win.
+    // Wrapping can cross the narrower last bucket, which costs one bucket.
+    int slack = wraps ? 2 : 1;
+    int maxRing = bucketsWide > bucketsHigh ? bucketsWide : bucketsHigh;
+    for (int r = 0; r <= maxRing; ++r) {
+        if (r >= slack && (r - slack) * BUCKET + 1 >= bestDistance) break;
+        for (int ry = -r; ry <= r; ++ry) {
+            // Only the edge of the ring, the inside was done already
+            int step = (ry == -r || ry == r) ? 1 : 2 * r;
+            for (int rx = -r; rx <= r; rx += step) {
+                int cx = bx + rx;
+                int cy = by + ry;
+                if (wraps) {
+                    cx = ((cx % bucketsWide) + bucketsWide) % bucketsWide;
+                    cy = ((cy % bucketsHigh) + bucketsHigh) % bucketsHigh;
+                } else if (cx < 0 || cx >= bucketsWide || cy < 0 || cy >= bucketsHigh) {
+                    continue;
+                }
+                const std::vector<int>& bucket = buckets[cy * bucketsWide + cx];
+                for (size_t i = 0; i < bucket.size(); ++i) {
+                    int dx = abs(bucket[i] % width - x);
+                    int dy = abs(bucket[i] / width - y);
+                    if (wraps) {
+                        if (width - dx < dx) dx = width - dx;
+                        if (height - dy < dy) dy = height - dy;
+                    }
+                    if (dx + dy < bestDistance) {
+                        bestDistance = dx + dy;
+                        best = bucket[i];
+                    }
+                }
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,61 @@
+#ifndef FOODFIELD_H
+#define FOODFIELD_H
+
+#include <vector>
+
+// Bookkeeping for games with many pieces of food: the set of empty cells,
+// so new food is placed in O(log cells), and the food bucketed on a coarse
+// grid, so the nearest piece is found without looking at all of them.
+class FoodField {
+public:
+    FoodField();
+
+    // Rebuild everything from the map's tile values
+    void build(const std::vector<int>& map, int width, int height);
+
+    // An empty cell became occupied, or an occupied one became empty
+    void occupy(int cell);
+    void release(int cell);
+
+    int freeCount() const { return freeTotal; }
+
+    // The n-th empty cell in map order. It depends only on the map, not on
+    // the order cells were freed in, so a game restored from a keyframe
+    // places its food where the original did.
+    int freeCell(int n) const;
+
+    // A piece of food appeared or was eaten
+    void addFood(int cell);
+    void removeFood(int cell);
+
+    int foodCount() const { return foods; }
+
+    // Cell of the food closest to (x, y) in moves, or -1 if there is none.
+    // wraps measures distance across the edges of the map.
+    int nearest(int x, int y, bool wraps) const;
+
+private:
+    static const int BUCKET = 8; // Bucket width and height in cells
+
+    int bucketOf(int cell) const;
+
+    int width;
+    int height;
+    int bucketsWide;
+    int bucketsHigh;
+    int foods;
+
+    // Empty cells counted in a Fenwick tree: freeTree[i] holds the number of
+    // empty cells in the (i & -i) cells ending at cell i - 1
+    std::vector<char> isFree;
+    std::vector<int> freeTree;
+    int freeTotal;
+    int freeTop;  // Highest power of two no bigger than the map
+
+    void countFree(int cell, int change);
+
+    std::vector<std::vector<int> > buckets; // Food cells in each bucket
+    std::vector<int> bucketSlot;            // Position of each food cell in its bucket
+};
+
+#endif
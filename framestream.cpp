@@ -0,0 +1,136 @@
+#include "framestream.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Redraw everything every so often so a spectator who joins late catches up
+static const long FULL_REDRAW_INTERVAL = 100;
+
+FrameStream::FrameStream()
+    : framesSent(0), framesDropped(0), bytesSent(0), fd(-1), ownsFd(false),
+      width(0), height(0), lastScore(-1), framesSinceFull(0) {
+}
+
+FrameStream::~FrameStream() {
+    close();
+}
+
+bool FrameStream::open(const char* path) {
+    close();
+    int flags = O_NONBLOCK | O_CLOEXEC;
+    int newFd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | flags, 0644);
+    if (newFd < 0 && errno == ENXIO) {
+        // A FIFO with no reader yet. Opening it read-write keeps the
+        // write end usable until a spectator shows up.
+        newFd = ::open(path, O_RDWR | flags);
+    }
+    if (newFd < 0) return false;
+    if (!attach(newFd)) {
+        ::close(newFd);
+        return false;
+    }
+    ownsFd = true;
+    return true;
+}
+
+bool FrameStream::attach(int newFd) {
+    int flags = fcntl(newFd, F_GETFL);
+    if (flags < 0 || fcntl(newFd, F_SETFL, flags | O_NONBLOCK) < 0) return false;
+    signal(SIGPIPE, SIG_IGN); // A spectator going away must not kill the game
+    fd = newFd;
+    return true;
+}
+
+void FrameStream::close() {
+    if (fd >= 0 && ownsFd) ::close(fd);
+    fd = -1;
+    ownsFd = false;
+    pending.clear();
+}
+
+void FrameStream::reset(int w, int h) {
+    width = w;
+    height = h;
+    glyphs.assign(width * height, ' ');
+    frame.reset(width, height, 2); // Board goes below the score line
+    lastScore = -1;
+    framesSinceFull = FULL_REDRAW_INTERVAL; // Start with a full redraw
+}
+
+// Try to finish a partially written frame. Returns true once nothing is left.
+bool FrameStream::flushPending() {
+    ssize_t n = write(fd, pending.data(), pending.size());
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) close();
+        return false;
+    }
+    bytesSent += n;
+    pending.erase(0, n);
+    return pending.empty();
+}
+
+void FrameStream::publish(const int* cells, char (*glyphOf)(int), int score) {
+    if (fd < 0) return;
+
+    // Still busy with an older frame: drop this one rather than wait
+    if (!pending.empty() && !flushPending()) {
+        ++framesDropped;
+        return;
+    }
+
+    for (int i = 0; i < width * height; ++i) {
+        glyphs[i] = glyphOf(cells[i]);
+    }
+
+    header.clear();
+    bool full = framesSinceFull >= FULL_REDRAW_INTERVAL;
+    if (full) {
+        frame.invalidate();
+        header += "\x1b[?25l\x1b[H\x1b[2J"; // Hide cursor, clear screen
+    }
+    if (full || score != lastScore) {
+        char buf[32];
+        int len = snprintf(buf, sizeof(buf), "\x1b[1;1HScore: %d\x1b[K", score);
+        header.append(buf, len);
+    }
+    const std::string& body = frame.encode(&glyphs[0]);
+
+    size_t total = header.size() + body.size();
+    ssize_t n = 0;
+    if (total > 0) {
+        struct iovec iov[2];
+        iov[0].iov_base = const_cast<char*>(header.data());
+        iov[0].iov_len = header.size();
+        iov[1].iov_base = const_cast<char*>(body.data());
+        iov[1].iov_len = body.size();
+        n = writev(fd, iov, 2);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                ++framesDropped; // Nothing went out; the next diff uses the old base
+            } else {
+                close();
+            }
+            return;
+        }
+    }
+
+    // At least part of the frame is on its way, so it becomes the new base
+    frame.commit();
+    lastScore = score;
+    framesSinceFull = full ? 1 : framesSinceFull + 1;
+    ++framesSent;
+    bytesSent += n;
+    if ((size_t)n < total) {
+        size_t sent = n;
+        if (sent < header.size()) {
+            pending.assign(header, sent, std::string::npos);
+            pending += body;
+        } else {
+            pending.assign(body, sent - header.size(), std::string::npos);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <string>
+#include <vector>
+
+#include "ansiframe.h"
+
+// Writes rendered frames as an ANSI stream to a file, pipe or FIFO so a
+// spectator can `cat` it in another terminal. Writes never block: if the
+// reader falls behind, frames are dropped instead of stalling the game.
+class FrameStream {
+public:
+    FrameStream();
+    ~FrameStream();
+
+    // Open a file or FIFO by path. A FIFO without a reader yet is fine.
+    bool open(const char* path);
+
+    // Stream to an already open descriptor (for example a pipe on stdout)
+    bool attach(int fd);
+
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // Prepare for a board of the given size (clears the spectator's screen)
+    void reset(int width, int height);
+
+    // Send one frame. Called once per tick; costs a single writev().
+    void publish(const int* cells, char (*glyphOf)(int), int score);
+
+    // Statistics
+    long framesSent;
+    long framesDropped;
+    long bytesSent;
+
+private:
+    bool flushPending();
+
+    int fd;
+    bool ownsFd;
+    int width;
+    int height;
+    int lastScore;            // Score shown in the header (-1 = not drawn yet)
+    long framesSinceFull;     // Frames since the last full redraw
+    AnsiFrame frame;
+    std::vector<char> glyphs; // Reused glyph buffer
+    std::string header;       // Reused header buffer
+    std::string pending;      // Unsent tail of a partially written frame
+};
+
+#endif
@@ -0,0 +1,541 @@
+// Differential fuzzer: plays random seeds and random key sequences through
+// a reference copy of the original snake*.cpp rules and through the engine
+// the game actually uses, in lockstep, and compares the whole game state
+// after every tick. A mismatch is shrunk to the shortest key sequence that
+// still shows it and saved as a replay.
+//
+//   ./fuzz --seconds 600            soak on every core for ten minutes
+//   ./fuzz --self-test              fuzz a deliberately broken engine
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "replay.h"
+#include "timing.h"
+#include "variants.h"
+
+using namespace std;
+
+// The rules as the original iterations wrote them: one map scan per move,
+// one function per step. Only the random number generator is the game's
+// own (xorshift64*, so runs are reproducible), the map size can vary, and
+// generateFood() gives up on a full map like the engine does instead of
+// looping forever.
+struct ReferenceGame {
+    int iteration; // Which snakeN.cpp: 1, 2, 3, 4 (also 5) or 6 (also 7)
+
+    int mapWidth;
+    int mapHeight;
+    int mapSize;
+    vector<int> map;
+    int headxpos;
+    int headypos;
+    int direction;
+    int food;
+    bool running;
+    int score;
+    bool wallsEnabled;
+    int difficulty;
+    bool isInForgivenessState;
+    int forgivenessCount;
+    uint64_t rngState;
+
+    unsigned int nextRandom() {
+        rngState ^= rngState >> 12;
+        rngState ^= rngState << 25;
+        rngState ^= rngState >> 27;
+        return static_cast<unsigned int>((rngState * 0x2545f4914f6cdd1dULL) >> 32);
+    }
+
+    void start(int iteration, int width, int height, bool walls, int difficulty, uint64_t seed) {
+        this->iteration = iteration;
+        mapWidth = width;
+        mapHeight = height;
+        mapSize = width * height;
+        map.assign(mapSize, 0);
+        food = 4;
+        score = 0;
+        // snake and snake2 always have walls
+        wallsEnabled = iteration <= 2 ? true : walls;
+        this->difficulty = difficulty;
+        isInForgivenessState = false;
+        forgivenessCount = 0;
+        rngState = seed != 0 ? seed : 1;
+        initMap();
+        running = true;
+    }
+
+    // Initialize the map
+    void initMap() {
+        // Initialize position of snake head
+        headxpos = mapWidth / 2;
+        headypos = mapHeight / 2;
+        direction = 0;
+        // Fill the map
+        for (int i = 0; i < mapSize; ++i) {
+            map[i] = 0;
+        }
+        // Set the head position
+        map[headypos * mapWidth + headxpos] = food;
+
+        // Place the walls on the edges if enabled
+        if (wallsEnabled) {
+            for (int x = 0; x < mapWidth; ++x) {
+                map[x] = WALL; // Top edge
+                map[(mapHeight - 1) * mapWidth + x] = WALL; // Bottom edge
+            }
+            for (int y = 0; y < mapHeight; ++y) {
+                map[y * mapWidth] = WALL; // Left edge
+                map[y * mapWidth + (mapWidth - 1)] = WALL; // Right edge
+            }
+        }
+
+        // Place the first piece of food
+        generateFood();
+    }
+
+    // Change the direction of the snake
+    void changeDirection(int key) {
+        switch (key) {
+            case 'w': if (direction != 2) direction = 0; break;
+            case 'd': if (direction != 3) direction = 1; break;
+            case 's': if (direction != 0) direction = 2; break;
+            case 'a': if (direction != 1) direction = 3; break;
+        }
+    }
+
+    // Move the snake in the given direction
+    void moveSnake(int dx, int dy) {
+        int newx = headxpos + dx;
+        int newy = headypos + dy;
+
+        if (iteration == 1) {
+            // If snake is in forgiveness state, don't move and wait for the next loop
+            if (isInForgivenessState) {
+                forgivenessCount--;
+                if (forgivenessCount <= 0) {
+                    isInForgivenessState = false;  // Reset forgiveness state after one loop
+                }
+                return;  // Return early to skip moving the snake
+            }
+
+            // Check if the snake hits the wall
+            if (newx < 0 || newx >= mapWidth || newy < 0 || newy >= mapHeight || map[newy * mapWidth + newx] == WALL) {
+                isInForgivenessState = true;  // Activate forgiveness state
+                forgivenessCount = 1;  // Snake will stay still for 1 loop
+                return;  // Return early, not allowing movement
+            }
+
+            // Check if the snake hits itself
+            if (map[newy * mapWidth + newx] > 0) {
+                isInForgivenessState = true;  // Activate forgiveness state
+                forgivenessCount = 1;  // Snake will stay still for 1 loop
+                return;  // Return early, not allowing movement
+            }
+        } else {
+            if (iteration == 2) {
+                // Check if the snake hits the wall
+                if (newx < 0 || newx >= mapWidth || newy < 0 || newy >= mapHeight || map[newy * mapWidth + newx] == WALL) {
+                    running = false; // End the game if the snake hits a wall
+                    return;
+                }
+            } else if (iteration == 3) {
+                // Check if the snake hits the wall
+                if (newx < 0 || newx >= mapWidth || newy < 0 || newy >= mapHeight || (wallsEnabled && map[newy * mapWidth + newx] == WALL)) {
+                    running = false; // End the game if the snake hits a wall
+                    return;
+                }
+            } else {
+                // If walls are not enabled, wrap the snake around the screen
+                if (!wallsEnabled) {
+                    if (newx < 0) newx = mapWidth - 1;
+                    if (newx >= mapWidth) newx = 0;
+                    if (newy < 0) newy = mapHeight - 1;
+                    if (newy >= mapHeight) newy = 0;
+                }
+                else { // If walls are enabled, check if the snake hits the wall
+                    if (newx < 0 || newx >= mapWidth || newy < 0 || newy >= mapHeight || map[newy * mapWidth + newx] == WALL) {
+                        running = false; // End the game if the snake hits a wall
+                        return;
+                    }
+                }
+            }
+
+            // Check if the snake hits itself (excluding the head's position)
+            if (map[newy * mapWidth + newx] > 0) {
+                running = false; // End the game if the snake hits its own body
+                return;
+            }
+        }
+
+        // Check if the snake eats the food
+        if (map[newy * mapWidth + newx] == -2) {
+            food++;
+            if (iteration == 6) {
+                score += 10 * difficulty; // Increase score by 10 times the difficulty level
+            } else {
+                score += 10; // Increase score by 10
+            }
+            generateFood(); // Generate new food
+        } else {
+            // Move the snake body
+            for (int i = 0; i < mapSize; ++i) {
+                if (map[i] > 0) {
+                    map[i]--; // Move the body forward
+                }
+            }
+        }
+
+        // Move the snake head
+        headxpos = newx;
+        headypos = newy;
+
+        // Set new head position
+        map[headypos * mapWidth + headxpos] = food; // Set head in new position
+    }
+
+    // Update the game state
+    void update() {
+        switch (direction) {
+            case 0: moveSnake(0, -1); break;
+            case 1: moveSnake(1, 0); break;
+            case 2: moveSnake(0, 1); break;
+            case 3: moveSnake(-1, 0); break;
+        }
+    }
+
+    // Generate food in a random position
+    void generateFood() {
+        int x, y;
+        long attempts = 0;
+        do {
+            if (++attempts % (4L * mapSize) == 0) {
+                bool full = true;
+                for (int i = 0; i < mapSize; ++i) {
+                    if (map[i] == 0) full = false;
+                }
+                if (full) return;
+            }
+            x = nextRandom() % mapWidth;
+            y = nextRandom() % mapHeight;
+        } while (map[y * mapWidth + x] != 0); // Make sure the food doesn't spawn on top of the snake
+        map[y * mapWidth + x] = -2; // Place food
+    }
+};
+
+// A deliberately broken engine for --self-test: without walls it forgets
+// to wrap through the top edge and ends the game instead
+class BrokenEngine : public Snake4Engine {
+public:
+    void update() {
+        if (direction == 0 && headypos == 0 && !wallsEnabled) {
+            running = false;
+            return;
+        }
+        Snake4Engine::update();
+    }
+};
+
+// One fuzz case: the rules, the board and the keys pressed on each tick
+// (0 for none)
+struct FuzzCase {
+    int rules;        // Index into the subjects table
+    int width;
+    int height;
+    bool walls;
+    int difficulty;
+    uint64_t seed;
+    vector<char> keys;
+};
+
+// Compare the engine with the reference. Writes what differs into why.
+template <class Engine>
+bool sameState(const Engine& game, const ReferenceGame& ref, string& why) {
+    char buf[160];
+    if (game.running != ref.running) {
+        snprintf(buf, sizeof(buf), "running %d, reference %d", game.running, ref.running);
+    } else if (game.headxpos != ref.headxpos || game.headypos != ref.headypos) {
+        snprintf(buf, sizeof(buf), "head at %d,%d, reference %d,%d", game.headxpos, game.headypos, ref.headxpos, ref.headypos);
+    } else if (game.direction != ref.direction) {
+        snprintf(buf, sizeof(buf), "direction %d, reference %d", game.direction, ref.direction);
+    } else if (game.food != ref.food || game.score != ref.score) {
+        snprintf(buf, sizeof(buf), "length %d score %d, reference %d and %d", game.food, game.score, ref.food, ref.score);
+    } else if (game.isInForgivenessState != ref.isInForgivenessState || game.forgivenessCount != ref.forgivenessCount) {
+        snprintf(buf, sizeof(buf), "forgiveness %d/%d, reference %d/%d", game.isInForgivenessState,
+                 game.forgivenessCount, ref.isInForgivenessState, ref.forgivenessCount);
+    } else if (game.rngState != ref.rngState) {
+        snprintf(buf, sizeof(buf), "random number generator out of step");
+    } else if (game.stateHash() != game.fullHash()) {
+        snprintf(buf, sizeof(buf), "position hash %016llx, worked out from the map %016llx",
+                 (unsigned long long)game.stateHash(), (unsigned long long)game.fullHash());
+    } else {
+        for (int i = 0; i < ref.mapSize; ++i) {
+            if (game.map[i] != ref.map[i]) {
+                snprintf(buf, sizeof(buf), "cell %d,%d is %d, reference %d", i % ref.mapWidth, i / ref.mapWidth, game.map[i], ref.map[i]);
+                why = buf;
+                return false;
+            }
+        }
+        return true;
+    }
+    why = buf;
+    return false;
+}
+
+// Play a case through both. Returns the tick after which they first differ
+// (0 = right after initMap), or -1 if they never do.
+template <class Engine>
+long firstMismatch(const FuzzCase& c, int iteration, string& why) {
+    Engine game;
+    game.resize(c.width, c.height);
+    game.seed(c.seed);
+    game.difficulty = c.difficulty;
+    game.wallsEnabled = c.walls;
+    game.initMap();
+    game.running = true;
+    ReferenceGame ref;
+    ref.start(iteration, c.width, c.height, c.walls, c.difficulty, c.seed);
+
+    if (!sameState(game, ref, why)) return 0;
+    for (size_t t = 0; t < c.keys.size() && ref.running; ++t) {
+        if (c.keys[t] != 0) {
+            game.changeDirection(c.keys[t]);
+            ref.changeDirection(c.keys[t]);
+        }
+        game.update();
+        ref.update();
+        if (!sameState(game, ref, why)) return t + 1;
+    }
+    return -1;
+}
+
+// Record a case as played by the engine, for watching with snakeN --replay
+template <class Engine>
+bool writeReplay(const FuzzCase& c, const char* path) {
+    Engine game;
+    game.resize(c.width, c.height);
+    game.seed(c.seed);
+    game.difficulty = c.difficulty;
+    game.wallsEnabled = c.walls;
+    game.initMap();
+    game.running = true;
+    ReplayWriter writer;
+    ReplayState state;
+    if (!writer.open(path, c.width, c.height, 1000, Engine::rules, c.seed, game.foodItems, game.foodValues)) {
+        return false;
+    }
+    for (size_t t = 0; t < c.keys.size() && game.running; ++t) {
+        // The keyframe is the state the last tick left, before this tick's key
+        if (writer.wantsKeyframe()) {
+            game.captureState(t, state);
+            writer.keyframe(state);
+        }
+        if (c.keys[t] != 0) game.changeDirection(c.keys[t]);
+        writer.input(game.direction);
+        game.update();
+    }
+    return writer.close();
+}
+
+// The engines under test, each paired with the iteration it must match
+struct Subject {
+    const char* name;
+    const char* program; // Game that plays back its replays
+    int iteration;
+    long (*mismatch)(const FuzzCase&, int, string&);
+    bool (*replay)(const FuzzCase&, const char*);
+};
+
+const Subject subjects[] = {
+    {"snake", "snake", 1, firstMismatch<SnakeEngine>, writeReplay<SnakeEngine>},
+    {"snake2", "snake2", 2, firstMismatch<Snake2Engine>, writeReplay<Snake2Engine>},
+    {"snake3", "snake3", 3, firstMismatch<Snake3Engine>, writeReplay<Snake3Engine>},
+    {"snake4", "snake4", 4, firstMismatch<Snake4Engine>, writeReplay<Snake4Engine>},
+    {"snake6", "snake6", 6, firstMismatch<Snake6Engine>, writeReplay<Snake6Engine>},
+};
+const Subject brokenSubject = {"broken", "snake4", 4, firstMismatch<BrokenEngine>, writeReplay<Snake4Engine>};
+
+// Fuzz settings
+int threads = 0;           // 0 = one per core
+double soakSeconds = 10;   // How long to run (0 = until a mismatch)
+long maxCases = 0;         // Stop after this many cases (0 = no limit)
+int maxKeys = 3000;        // Longest key sequence
+uint64_t baseSeed = 1;
+bool selfTest = false;
+const char* outPath = "fuzz-failure.snr";
+
+// Shared between the workers
+atomic<long> nextCase(0);
+atomic<long> ticksPlayed(0);
+atomic<bool> found(false);
+mutex foundLock;
+FuzzCase failure;
+string failureWhy;
+
+// Number generator for building cases (splitmix64)
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Case number n, the same every run with the same --seed
+static void makeCase(long n, FuzzCase& c) {
+    uint64_t r = mix(baseSeed * 0x100000001b3ULL + n);
+    c.rules = selfTest ? 0 : r % (sizeof(subjects) / sizeof(subjects[0]));
+    r = mix(r);
+    c.width = 5 + r % 56;
+    c.height = 5 + (r >> 8) % 26;
+    c.walls = (r >> 16) & 1;
+    c.difficulty = 1 + (r >> 20) % 9;
+    c.seed = mix(r) | 1;
+    r = mix(c.seed);
+    c.keys.resize(1 + r % maxKeys);
+    // Mostly no key, so the snake travels; turns in bursts now and then
+    const char keys[4] = {'w', 'd', 's', 'a'};
+    for (size_t t = 0; t < c.keys.size(); ++t) {
+        r = mix(r);
+        c.keys[t] = (r % 100) < 20 ? keys[(r >> 8) & 3] : 0;
+    }
+}
+
+static const Subject& subjectOf(const FuzzCase& c) {
+    return selfTest ? brokenSubject : subjects[c.rules];
+}
+
+// Make a failing case as small as possible: cut the keys after the
+// mismatch, then drop ever smaller runs of ticks, then clear single keys,
+// keeping each change that still fails
+static void shrink(FuzzCase& c, string& why) {
+    const Subject& subject = subjectOf(c);
+    long at = subject.mismatch(c, subject.iteration, why);
+    c.keys.resize(at);
+
+    for (size_t chunk = c.keys.size() / 2; chunk >= 1; chunk /= 2) {
+        for (size_t start = 0; start + chunk <= c.keys.size(); ) {
+            FuzzCase smaller = c;
+            smaller.keys.erase(smaller.keys.begin() + start, smaller.keys.begin() + start + chunk);
+            string smallerWhy;
+            long smallerAt = subject.mismatch(smaller, subject.iteration, smallerWhy);
+            if (smallerAt >= 0) {
+                smaller.keys.resize(smallerAt);
+                c = smaller;
+                why = smallerWhy;
+            } else {
+                start += chunk;
+            }
+        }
+    }
+    for (size_t t = 0; t < c.keys.size(); ++t) {
+        if (c.keys[t] == 0) continue;
+        FuzzCase smaller = c;
+        smaller.keys[t] = 0;
+        string smallerWhy;
+        if (subject.mismatch(smaller, subject.iteration, smallerWhy) >= 0) {
+            c = smaller;
+            why = smallerWhy;
+        }
+    }
+}
+
+// Worker thread: play cases until time runs out or something fails
+static void soak(struct timespec start) {
+    FuzzCase c;
+    string why;
+    while (!found) {
+        long n = nextCase++;
+        if (maxCases > 0 && n >= maxCases) break;
+        if (soakSeconds > 0 && (n & 63) == 0 && secondsSince(start) > soakSeconds) break;
+        makeCase(n, c);
+        const Subject& subject = subjectOf(c);
+        long at = subject.mismatch(c, subject.iteration, why);
+        ticksPlayed += at < 0 ? c.keys.size() : at;
+        if (at >= 0) {
+            lock_guard<mutex> lock(foundLock);
+            if (!found) {
+                found = true;
+                failure = c;
+                failureWhy = why;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            soakSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--cases") == 0 && i + 1 < argc) {
+            maxCases = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+            maxKeys = atoi(argv[++i]);
+            ok = maxKeys >= 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            baseSeed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--self-test") == 0) {
+            selfTest = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Usage: %s [--threads N] [--seconds S] [--cases N] [--keys N] [--seed N]\n"
+                        "       [--self-test] [--out REPLAY]\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) {
+        threads = thread::hardware_concurrency();
+        if (threads < 1) threads = 1;
+    }
+
+    struct timespec start = monotonicNow();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(thread(soak, start));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    double seconds = secondsSince(start);
+    long cases = nextCase - threads; // Each worker took one more it didn't play
+    if (cases < 0) cases = 0;
+    if (maxCases > 0 && cases > maxCases) cases = maxCases;
+    printf("%ld cases, %ld ticks in %.1f s on %d threads: %.0f ticks/s\n",
+           cases, ticksPlayed.load(), seconds, threads, ticksPlayed / seconds);
+
+    if (!found) {
+        printf("No differences from the reference\n");
+        return 0;
+    }
+
+    const Subject& subject = subjectOf(failure);
+    printf("MISMATCH in %s after %zu keys: %s\n", subject.name, failure.keys.size(), failureWhy.c_str());
+    shrink(failure, failureWhy);
+    string keys;
+    for (size_t t = 0; t < failure.keys.size(); ++t) {
+        keys += failure.keys[t] != 0 ? failure.keys[t] : '.';
+    }
+    printf("Shrunk to %zu ticks: %s\n", failure.keys.size(), failureWhy.c_str());
+    printf("  rules %s, size %dx%d, walls %s, difficulty %d, seed %llu\n", subject.name,
+           failure.width, failure.height, failure.walls ? "y" : "n", failure.difficulty,
+           (unsigned long long)failure.seed);
+    printf("  keys (one per tick, '.' for none): %s\n", keys.c_str());
+    if (subject.replay(failure, outPath)) {
+        printf("  replay: ./%s --replay %s\n", subject.program, outPath);
+    } else {
+        perror(outPath);
+    }
+    return 2;
+}
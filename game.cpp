@@ -0,0 +1,314 @@
+#include "game.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "replay.h"
+
+Game::Game()
+    : mapWidth(0), mapHeight(0), mapSize(0), headxpos(0), headypos(0), direction(0),
+      food(START_LENGTH), running(false), score(0), collision(COLLIDE_NONE), difficulty(5), wallsEnabled(true),
+      isInForgivenessState(false), forgivenessCount(0), foodItems(1), rngState(1), lastFoodCell(-1),
+      bodyHash(0), foodHash(0), layoutHash(0), tailCell(-1), headPower(1) {
+    resize(DEFAULT_MAP_WIDTH, DEFAULT_MAP_HEIGHT);
+}
+
+void Game::resize(int width, int height) {
+    mapWidth = width;
+    mapHeight = height;
+    mapSize = width * height;
+    map.assign(mapSize, EMPTY);
+    spawnx = mapWidth / 2;
+    spawny = mapHeight / 2;
+    spawnDirection = 0;
+    levelMap.clear();
+    wallMask.clear();
+    foodZones.clear();
+}
+
+void Game::loadLevel(const Level& level) {
+    resize(level.width, level.height);
+    spawnx = level.spawnx;
+    spawny = level.spawny;
+    spawnDirection = level.spawnDirection;
+    wallMask.assign(level.walls, level.walls + wallWords(level.width, level.height));
+    levelMap.resize(mapSize);
+    for (int i = 0; i < mapSize; ++i) {
+        levelMap[i] = level.isWall(i) ? WALL : EMPTY;
+    }
+    foodZones.assign(level.zones, level.zones + level.zoneCount);
+}
+
+void Game::seed(uint64_t seed) {
+    rngState = seed != 0 ? seed : 1; // xorshift never leaves zero
+}
+
+unsigned int Game::nextRandom() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return static_cast<unsigned int>((rngState * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+void Game::changeDirection(int key) {
+    switch (key) {
+        case 'w': if (direction != 2) direction = 0; break;
+        case 'd': if (direction != 3) direction = 1; break;
+        case 's': if (direction != 0) direction = 2; break;
+        case 'a': if (direction != 1) direction = 3; break;
+    }
+}
+
+void Game::generateFood() {
+    int x, y;
+    lastFoodCell = -1;
+
+    // With many pieces of food, draw from the empty cells instead of
+    // guessing, so a crowded map costs the same as an empty one
+    if (multiFood()) {
+        int tile = FOOD;
+        if (!foodValues.empty()) {
+            tile = foodTile(foodValues[nextRandom() % foodValues.size()]);
+        }
+        int cell = -1;
+        for (int attempt = 0; attempt < 64 && !foodZones.empty(); ++attempt) {
+            const FoodZone& zone = foodZones[nextRandom() % foodZones.size()];
+            x = zone.x + nextRandom() % zone.width;
+            y = zone.y + nextRandom() % zone.height;
+            if (map[y * mapWidth + x] == 0) {
+                cell = y * mapWidth + x;
+                break;
+            }
+        }
+        if (cell < 0) {
+            if (foodField.freeCount() == 0) return; // Nowhere left to put it
+            cell = foodField.freeCell(nextRandom() % foodField.freeCount());
+        }
+        map[cell] = tile;
+        foodHash ^= foodKey(cell, tile);
+        lastFoodCell = cell;
+        foodField.occupy(cell);
+        foodField.addFood(cell);
+        return;
+    }
+
+    // Try the level's food zones first; fall back to the whole map if they're full
+    if (!foodZones.empty()) {
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            const FoodZone& zone = foodZones[nextRandom() % foodZones.size()];
+            x = zone.x + nextRandom() % zone.width;
+            y = zone.y + nextRandom() % zone.height;
+            if (map[y * mapWidth + x] == 0) {
+                map[y * mapWidth + x] = FOOD;
+                lastFoodCell = y * mapWidth + x;
+                foodHash ^= foodKey(lastFoodCell, FOOD);
+                return;
+            }
+        }
+    }
+
+    long attempts = 0;
+    do {
+        // Every so often make sure there is room at all; a full map would loop forever
+        if (++attempts % (4L * mapSize) == 0 && !hasEmptyCell()) return;
+        x = nextRandom() % mapWidth;
+        y = nextRandom() % mapHeight;
+    } while (map[y * mapWidth + x] != 0); // Make sure the food doesn't spawn on top of the snake
+    map[y * mapWidth + x] = FOOD; // Place food
+    lastFoodCell = y * mapWidth + x;
+    foodHash ^= foodKey(lastFoodCell, FOOD);
+}
+
+bool Game::hasEmptyCell() const {
+    for (int i = 0; i < mapSize; ++i) {
+        if (map[i] == EMPTY) return true;
+    }
+    return false;
+}
+
+void Game::placeFood() {
+    if (multiFood()) {
+        foodField.build(map, mapWidth, mapHeight);
+    }
+    for (int i = 0; i < foodItems; ++i) {
+        generateFood();
+    }
+}
+
+void Game::placeWalls() {
+    for (int x = 0; x < mapWidth; ++x) {
+        map[x] = WALL; // Top edge
+        map[(mapHeight - 1) * mapWidth + x] = WALL; // Bottom edge
+    }
+    for (int y = 0; y < mapHeight; ++y) {
+        map[y * mapWidth] = WALL; // Left edge
+        map[y * mapWidth + (mapWidth - 1)] = WALL; // Right edge
+    }
+}
+
+// x^e by repeated squaring
+static uint64_t gfPower(uint32_t e) {
+    uint64_t power = 1;
+    for (uint64_t square = 2; e != 0; e >>= 1) {
+        if (e & 1) power = gfMultiply(power, square);
+        square = gfMultiply(square, square);
+    }
+    return power;
+}
+
+// x^v for the lifetimes a snake on this map can have, 0 to the length but
+// never more than the map holds: the table is sized by the map, not by
+// values in it, which a damaged state could make anything
+static std::vector<uint64_t> lifetimePowers(int food, int mapSize) {
+    int longest = food >= 0 && food < mapSize ? food : mapSize;
+    std::vector<uint64_t> powers(longest + 1);
+    powers[0] = 1;
+    for (int v = 1; v <= longest; ++v) {
+        powers[v] = gfTimesX(powers[v - 1]);
+    }
+    return powers;
+}
+
+// x^v, from the table when it covers v
+static uint64_t lifetimePower(const std::vector<uint64_t>& powers, int v) {
+    return v >= 0 && (size_t)v < powers.size() ? powers[v] : gfPower(static_cast<uint32_t>(v));
+}
+
+uint64_t Game::fullHash() const {
+    std::vector<uint64_t> powers = lifetimePowers(food, mapSize);
+    uint64_t hash = zobristKey(ZOBRIST_SIZE | (uint64_t)mapWidth << 20 | mapHeight);
+    for (int i = 0; i < mapSize; ++i) {
+        if (map[i] > 0) hash ^= bodyKey(i, lifetimePower(powers, map[i]));
+        else if (map[i] == WALL) hash ^= zobristKey(ZOBRIST_WALL | i);
+        else if (isFood(map[i])) hash ^= foodKey(i, map[i]);
+    }
+    return hash ^ zobristKey(ZOBRIST_HEAD | (headypos * mapWidth + headxpos)) ^ zobristKey(ZOBRIST_DIRECTION | direction);
+}
+
+void Game::rehash() {
+    std::vector<uint64_t> powers = lifetimePowers(food, mapSize);
+    headPower = lifetimePower(powers, food);
+    bodyHash = 0;
+    foodHash = 0;
+    layoutHash = zobristKey(ZOBRIST_SIZE | (uint64_t)mapWidth << 20 | mapHeight);
+    tailCell = -1;
+    for (int i = 0; i < mapSize; ++i) {
+        if (map[i] > 0) {
+            bodyHash ^= bodyKey(i, lifetimePower(powers, map[i]));
+            if (tailCell < 0 || map[i] < map[tailCell]) tailCell = i;
+        } else if (map[i] == WALL) {
+            layoutHash ^= zobristKey(ZOBRIST_WALL | i);
+        } else if (isFood(map[i])) {
+            foodHash ^= foodKey(i, map[i]);
+        }
+    }
+}
+
+void Game::ageBody() {
+    if (tailCell >= 0 && map[tailCell] == 1) {
+        bodyHash ^= gfTimesX(zobristKey(tailCell)); // bodyKey(tailCell, x)
+        // The next cell of the body is the neighbour one tick younger
+        // (lifetimes are all different, so looking across the edges of a
+        // map that doesn't wrap can't find the wrong one)
+        int x = tailCell % mapWidth;
+        int y = tailCell / mapWidth;
+        int next[4] = {y * mapWidth + (x + 1) % mapWidth, y * mapWidth + (x + mapWidth - 1) % mapWidth,
+                       (y + 1) % mapHeight * mapWidth + x, (y + mapHeight - 1) % mapHeight * mapWidth + x};
+        tailCell = -1;
+        for (int i = 0; i < 4; ++i) {
+            if (map[next[i]] == 2) tailCell = next[i];
+        }
+    }
+    bodyHash = gfOverX(bodyHash);
+}
+
+void Game::captureState(long tick, ReplayState& state) const {
+    ReplayKeyframe& k = state.keyframe;
+    memset(&k, 0, sizeof(k));
+    k.tick = tick;
+    k.rngState = rngState;
+    k.headx = headxpos;
+    k.heady = headypos;
+    k.direction = direction;
+    k.food = food;
+    k.score = score;
+    k.forgiving = isInForgivenessState;
+    k.forgivenessCount = forgivenessCount;
+    k.difficulty = difficulty;
+    state.cells.assign(map.begin(), map.end());
+}
+
+void Game::restoreState(const ReplayState& state) {
+    const ReplayKeyframe& k = state.keyframe;
+    rngState = k.rngState;
+    headxpos = k.headx;
+    headypos = k.heady;
+    direction = k.direction;
+    food = k.food;
+    score = k.score;
+    isInForgivenessState = k.forgiving != 0;
+    forgivenessCount = k.forgivenessCount;
+    difficulty = k.difficulty;
+    map.assign(state.cells.begin(), state.cells.end());
+    if (multiFood()) {
+        foodField.build(map, mapWidth, mapHeight);
+    }
+    rehash();
+    running = true;
+}
+
+char getMapValue(int value) {
+    if (value > 0) return 'o'; // Snake body
+    switch (value) {
+        case HEAD: return 'O'; // Snake head
+        case FOOD: return 'X'; // Food
+        case WALL: return '#'; // Wall
+    }
+    if (isFood(value)) return '$'; // Food worth more
+    return ' ';
+}
+
+int nearestFood(const Game& game, bool wraps) {
+    if (game.multiFood()) {
+        return game.foodField.nearest(game.headxpos, game.headypos, wraps);
+    }
+    for (int i = 0; i < game.mapSize; ++i) {
+        if (game.map[i] == FOOD) return i;
+    }
+    return -1;
+}
+
+int autopilotKey(const Game& game, bool wraps) {
+    // Find the food
+    int foodx = game.headxpos, foody = game.headypos;
+    int cell = nearestFood(game, wraps);
+    if (cell >= 0) {
+        foodx = cell % game.mapWidth;
+        foody = cell / game.mapWidth;
+    }
+
+    const int dx[4] = {0, 1, 0, -1};
+    const int dy[4] = {-1, 0, 1, 0};
+    const char keys[4] = {'w', 'd', 's', 'a'};
+    int best = NO_KEY;
+    int bestDistance = game.mapSize;
+    for (int d = 0; d < 4; ++d) {
+        if (d == (game.direction + 2) % 4) continue; // Can't turn back on itself
+        int x = game.headxpos + dx[d];
+        int y = game.headypos + dy[d];
+        if (wraps) {
+            x = (x + game.mapWidth) % game.mapWidth;
+            y = (y + game.mapHeight) % game.mapHeight;
+        } else if (x < 0 || x >= game.mapWidth || y < 0 || y >= game.mapHeight) {
+            continue;
+        }
+        int value = game.map[y * game.mapWidth + x];
+        if (value == WALL || value > 0) continue;
+        int distance = abs(foodx - x) + abs(foody - y);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = keys[d];
+        }
+    }
+    return best;
+}
@@ -0,0 +1,272 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <cstdint>
+#include <vector>
+
+#include "foodfield.h"
+#include "level.h"
+
+struct ReplayState;
+
+// The tile values for the map. Positive values are the snake's body: how
+// many more ticks that cell stays occupied.
+const int EMPTY = 0;
+const int HEAD = -1; // Never stored by the engine, the head holds the body length
+const int FOOD = -2;
+const int WALL = -3;
+
+// Food worth more than one helping is stored as FOOD_VALUE_BASE - value, so
+// a replay's cells carry it and FOOD stays the plain, one-helping food.
+const int FOOD_VALUE_BASE = -10;
+const int MAX_FOOD_VALUE = 9;
+
+// Whether a tile is food of any value, and what it's worth
+inline bool isFood(int value) { return value == FOOD || value < FOOD_VALUE_BASE - 1; }
+inline int foodValue(int value) { return value == FOOD ? 1 : FOOD_VALUE_BASE - value; }
+inline int foodTile(int value) { return value <= 1 ? FOOD : FOOD_VALUE_BASE - value; }
+
+// A value the engine could have stored in a cell, with the snake food long
+inline bool validCell(int value, int food) {
+    if (value > 0) return value <= food;
+    if (value == EMPTY || value == WALL || value == FOOD) return true;
+    return isFood(value) && foodValue(value) <= MAX_FOOD_VALUE;
+}
+
+// What the snake ran into last (Game::collision)
+const int COLLIDE_NONE = 0;
+const int COLLIDE_EDGE = 1; // Left the map
+const int COLLIDE_WALL = 2;
+const int COLLIDE_BODY = 3;
+
+// Colours a tile can be drawn in (see getMapColour). Renderers decide what
+// each looks like; COLOUR_PLAIN is the terminal's own.
+const int COLOUR_PLAIN = 0;
+const int COLOUR_HEAD = 1;
+const int COLOUR_BODY = 2;      // The body fades through BODY_SHADES colours, head to tail
+const int BODY_SHADES = 4;
+const int SHADE_STEP = 8;       // Frames between moves of the boundaries between shades
+const int COLOUR_FOOD = COLOUR_BODY + BODY_SHADES;
+const int COLOUR_RICH_FOOD = COLOUR_FOOD + 1;
+const int COLOUR_WALL = COLOUR_FOOD + 2;
+const int COLOUR_COUNT = COLOUR_FOOD + 3;
+
+// Value returned when no key is pressed
+const int NO_KEY = -1;
+
+// Default map dimensions
+const int DEFAULT_MAP_WIDTH = 40;
+const int DEFAULT_MAP_HEIGHT = 20;
+const int START_LENGTH = 4; // Snake length at the start of every game
+
+// Zobrist keys for hashing positions: a random-looking 64-bit number for
+// each thing that can be somewhere, made on the fly from its index
+// (splitmix64) so no table has to grow with the map
+const uint64_t ZOBRIST_FOOD = 1ULL << 40;
+const uint64_t ZOBRIST_WALL = 2ULL << 40;
+const uint64_t ZOBRIST_HEAD = 3ULL << 40;
+const uint64_t ZOBRIST_DIRECTION = 4ULL << 40;
+const uint64_t ZOBRIST_SIZE = 5ULL << 40;
+const uint64_t ZOBRIST_WRAPS = 6ULL << 40;
+
+inline uint64_t zobristKey(uint64_t n) {
+    n += 0x9e3779b97f4a7c15ULL;
+    n = (n ^ (n >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    n = (n ^ (n >> 27)) * 0x94d049bb133111ebULL;
+    return n ^ (n >> 31);
+}
+
+// Body keys are numbers in GF(2^64), taken modulo the primitive polynomial
+// x^64 + x^4 + x^3 + x + 1. A body cell's key is the cell's times x to the
+// power of its lifetime, so every lifetime dropping by one is the XOR of
+// them all divided by x: a shift and a masked XOR. x has order 2^64 - 1, so
+// no two lifetimes a snake can have get the same factor.
+const uint64_t GF_POLY = 0x1B; // The polynomial without its x^64 term
+
+inline uint64_t gfTimesX(uint64_t a) {
+    return a << 1 ^ (GF_POLY & -(a >> 63));
+}
+
+inline uint64_t gfOverX(uint64_t a) {
+    return a >> 1 ^ ((1ULL << 63 | GF_POLY >> 1) & -(a & 1));
+}
+
+inline uint64_t gfMultiply(uint64_t a, uint64_t b) {
+    uint64_t product = 0;
+    for (; b != 0; b >>= 1) {
+        product ^= a & -(b & 1);
+        a = gfTimesX(a);
+    }
+    return product;
+}
+
+// Key of a body cell whose lifetime is v, given power = x^v
+inline uint64_t bodyKey(int cell, uint64_t power) {
+    return gfMultiply(zobristKey(cell), power);
+}
+
+inline uint64_t foodKey(int cell, int tile) {
+    return zobristKey(ZOBRIST_FOOD | (uint64_t)cell << 4 | foodValue(tile));
+}
+
+// The state of one game, shared by every rule set. The rules themselves
+// (moving, walls, scoring, speed) live in Engine, see engine.h.
+struct Game {
+    Game();
+
+    // Set the map dimensions (clears the map and any level)
+    void resize(int width, int height);
+
+    // Play on a level: its size, walls, spawn point and food zones
+    void loadLevel(const Level& level);
+
+    // Seed the random number generator
+    void seed(uint64_t seed);
+
+    // Next number from the game's random number generator (xorshift64*)
+    unsigned int nextRandom();
+
+    // Change the direction of the snake
+    void changeDirection(int key);
+
+    // Generate food in a random position
+    void generateFood();
+
+    // Whether any cell is free for food
+    bool hasEmptyCell() const;
+
+    // Put out the pieces of food a new game starts with
+    void placeFood();
+
+    // Whether more than the one classic piece of food is on the map
+    bool multiFood() const { return foodItems > 1 || !foodValues.empty(); }
+
+    // Place the walls on the edges
+    void placeWalls();
+
+    // Whether a level sets the walls instead of the rules
+    bool hasLevel() const { return !levelMap.empty(); }
+
+    // Hash of the position: the body with each cell's lifetime, the food,
+    // the head, the direction, the walls and the map size. Equal positions
+    // hash the same however they were reached.
+    uint64_t stateHash() const {
+        return bodyHash ^ foodHash ^ layoutHash ^ zobristKey(ZOBRIST_HEAD | (headypos * mapWidth + headxpos)) ^
+               zobristKey(ZOBRIST_DIRECTION | direction);
+    }
+
+    // stateHash() worked out from the map, for checking the one kept up to date
+    uint64_t fullHash() const;
+
+    // Work the hashes and the tail out from the map again, after changing it by hand
+    void rehash();
+
+    // The body moves on without growing: the tail leaves its cell if its
+    // time is up and every lifetime drops by one. Keeps the hash and the
+    // tail up to date; call before the engine lowers the lifetimes.
+    void ageBody();
+
+    // Copy the whole game state, or put a copy back
+    void captureState(long tick, ReplayState& state) const;
+    void restoreState(const ReplayState& state);
+
+    // Map dimensions
+    int mapWidth;
+    int mapHeight;
+    int mapSize;
+
+    // The tile values for the map
+    std::vector<int> map;
+
+    // Snake head details
+    int headxpos;
+    int headypos;
+    int direction;
+
+    // Amount of food the snake has (How long the body is)
+    int food;
+
+    // Determine if game is running
+    bool running;
+
+    // Score
+    int score;
+
+    // What the snake last ran into, COLLIDE_NONE if nothing yet
+    int collision;
+
+    // Difficulty and wall option
+    int difficulty;     // 1-9, sets speed and score in some rule sets
+    bool wallsEnabled;  // Walls on the edges in rule sets where they are optional
+
+    // Forgiveness state for rule sets that pause on a collision
+    bool isInForgivenessState; // Whether the snake is in a forgiveness state
+    int forgivenessCount;      // How many game loops the snake has been in the forgiveness state
+
+    // Pieces of food on the map at once, and what each new one is worth
+    // (picked at random from foodValues; empty = always 1)
+    int foodItems;
+    std::vector<int> foodValues;
+
+    // Empty cells and food by position, kept up to date only with multiFood()
+    FoodField foodField;
+
+    // Random number generator state, saved in replays
+    uint64_t rngState;
+
+    // Where generateFood() last put food, -1 if it found nowhere
+    int lastFoodCell;
+
+    // Parts of stateHash(), kept up to date in O(1) a tick by moveSnake()
+    // and generateFood(); the layout is hashed once a game by initMap()
+    uint64_t bodyHash;   // bodyKey() of every body cell
+    uint64_t foodHash;   // foodKey() of every piece of food
+    uint64_t layoutHash; // The walls and the map size
+    int tailCell;        // Body cell with the shortest lifetime, the next to be left
+    uint64_t headPower;  // x^food, for the key of the cell the head moves into
+
+    // Where and which way the snake starts
+    int spawnx;
+    int spawny;
+    int spawnDirection;
+
+    // Level layout (empty without a level). Walls are turned into tile
+    // values once at load time, so a game starts with one copy and every
+    // collision check stays a single lookup in map.
+    std::vector<int> levelMap;
+    std::vector<uint64_t> wallMask;   // One bit per cell, set for walls
+    std::vector<FoodZone> foodZones;  // Where food may appear (empty = anywhere)
+};
+
+// Get the char representation of the map value
+char getMapValue(int value);
+
+// Get the colour to draw a tile in, given the snake's length (the head's
+// value) and a count of the frames drawn so far. Inline, since renderers
+// call it for every cell of every frame.
+inline int getMapColour(int value, int length, long frame) {
+    if (value > 0) {
+        if (value >= length) return COLOUR_HEAD;
+        // Darker towards the tail. A cell ages one step a frame, so shades
+        // by age would move every boundary every frame; holding the age
+        // back by frame % SHADE_STEP makes them jump SHADE_STEP cells at once.
+        long age = length - 1 - value - frame % SHADE_STEP;
+        if (age < 0) age = 0;
+        int shade = age * BODY_SHADES / (length - 1);
+        return COLOUR_BODY + (shade < BODY_SHADES ? shade : BODY_SHADES - 1);
+    }
+    if (value == FOOD) return COLOUR_FOOD;
+    if (value == WALL) return COLOUR_WALL;
+    if (isFood(value)) return COLOUR_RICH_FOOD;
+    return COLOUR_PLAIN;
+}
+
+
+// Cell of the food closest to the snake's head, or -1 if there is none
+int nearestFood(const Game& game, bool wraps);
+
+// Pick a key that heads towards the nearest food without running into anything.
+// wraps says whether leaving the map comes back on the other side.
+int autopilotKey(const Game& game, bool wraps);
+
+#endif
@@ -0,0 +1,84 @@
+#include "renderer.h"
+
+// Glyph codes for the half blocks, sent as UTF-8 (see AnsiFrame::setGlyphs)
+const char UPPER_HALF = '\x80';
+const char LOWER_HALF = '\x81';
+const char FULL_BLOCK = '\x82';
+
+HalfBlockRenderer::HalfBlockRenderer(int fd) : AnsiRenderer(fd) {
+    // Work out every (top, bottom) pair of tile colours once. A style is a
+    // foreground and background tile colour, numbered fg * COLOUR_COUNT + bg.
+    for (int top = 0; top < COLOUR_COUNT; ++top) {
+        for (int bottom = 0; bottom < COLOUR_COUNT; ++bottom) {
+            int pair = top * COLOUR_COUNT + bottom;
+            if (top == COLOUR_PLAIN && bottom == COLOUR_PLAIN) {
+                pairGlyph[pair] = ' ';
+                pairStyle[pair] = COLOUR_PLAIN;
+            } else if (top == bottom) {
+                pairGlyph[pair] = FULL_BLOCK;
+                pairStyle[pair] = top * COLOUR_COUNT;
+            } else if (bottom == COLOUR_PLAIN) {
+                pairGlyph[pair] = UPPER_HALF;
+                pairStyle[pair] = top * COLOUR_COUNT;
+            } else if (top == COLOUR_PLAIN) {
+                pairGlyph[pair] = LOWER_HALF;
+                pairStyle[pair] = bottom * COLOUR_COUNT;
+            } else {
+                pairGlyph[pair] = UPPER_HALF; // Top in the foreground, bottom behind it
+                pairStyle[pair] = top * COLOUR_COUNT + bottom;
+            }
+        }
+    }
+}
+
+void HalfBlockRenderer::buildPalette() {
+    std::vector<std::string> blocks;
+    blocks.push_back("\xe2\x96\x80"); // U+2580 upper half block
+    blocks.push_back("\xe2\x96\x84"); // U+2584 lower half block
+    blocks.push_back("\xe2\x96\x88"); // U+2588 full block
+    frame.setGlyphs(blocks);
+
+    // SGR sequences between every pair of styles
+    bool has256 = terminalHas256Colours();
+    const int styleCount = COLOUR_COUNT * COLOUR_COUNT;
+    std::vector<TextStyle> styles(styleCount);
+    for (int i = 0; i < styleCount; ++i) {
+        const ColourStyle& fg = colourStyle(i / COLOUR_COUNT);
+        const ColourStyle& bg = colourStyle(i % COLOUR_COUNT);
+        styles[i].intensity = fg.intensity;
+        styles[i].fg = has256 ? fg.colour256 : fg.colour16;
+        styles[i].bg = has256 ? bg.colour256 : bg.colour16;
+    }
+    std::vector<std::string> transitions(styleCount * styleCount);
+    for (int from = 0; from < styleCount; ++from) {
+        for (int to = 0; to < styleCount; ++to) {
+            transitions[from * styleCount + to] = sgrTransition(styles[from], styles[to], has256);
+        }
+    }
+    frame.setPalette(transitions, styleCount);
+    havePalette = true;
+}
+
+void HalfBlockRenderer::drawFrame(const int* cells, int w, int h, char (*)(int), int score, int length) {
+    int rows = (h + 1) / 2;
+    if (w != width || rows != height) {
+        resizeGrid(w, rows);
+    }
+    if (!havePalette) buildPalette();
+
+    // One lookup per pair of tiles; an odd last row has nothing below it
+    const unsigned char* colourOf = colourTable(length);
+    for (int y = 0; y < rows; ++y) {
+        const int* top = cells + 2 * y * w;
+        const int* bottom = 2 * y + 1 < h ? top + w : NULL;
+        char* glyphRow = &glyphs[y * w];
+        unsigned char* styleRow = &colours[y * w];
+        for (int x = 0; x < w; ++x) {
+            int pair = colourOf[top[x]] * COLOUR_COUNT;
+            if (bottom != NULL) pair += colourOf[bottom[x]];
+            glyphRow[x] = pairGlyph[pair];
+            styleRow[x] = pairStyle[pair];
+        }
+    }
+    sendFrame(&colours[0], score);
+}
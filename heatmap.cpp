@@ -0,0 +1,346 @@
+// Heatmaps: plays a batch of headless games with any bot, in parallel, and
+// counts for every cell how often the head was there, how many snakes died
+// there, how often food appeared there and, when the map has walls, how
+// long the head spent there next to a wall.
+//
+//   ./heatmap --bot flood --games 100000 --rules snake2 -o flood
+//
+// writes flood.heat and one image per map (flood-visits.pgm,
+// flood-deaths.pgm, flood-food.pgm, flood-walls.pgm), shaded on a log
+// scale from black (never) to white (the most). Game g is played with seed
+// --seed + g, so the counts don't depend on the number of threads.
+//
+// .heat layout (native byte order):
+//
+//   HeatHeader
+//   uint64_t counts[HEAT_MAPS][height][width]   in the order of heatMapNames
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bots.h"
+#include "timing.h"
+#include "variants.h"
+
+using namespace std;
+
+const int HEAT_MAPS = 4;
+const char* heatMapNames[HEAT_MAPS] = {"visits", "deaths", "food", "walls"};
+const int MAP_VISITS = 0;
+const int MAP_DEATHS = 1;
+const int MAP_FOOD = 2;
+const int MAP_WALLS = 3;
+
+struct HeatHeader {
+    char magic[4];     // "SNKH"
+    uint32_t version;  // 1
+    uint32_t width;
+    uint32_t height;
+    uint32_t maps;     // HEAT_MAPS
+    uint32_t rules;
+    uint64_t games;
+    uint64_t ticks;
+};
+
+// Settings
+const char* botName = "greedy";
+long games = 10000;
+uint64_t firstSeed = 1;
+int threads = 0;            // 0 = one per core
+long maxTicks = 20000;      // Tick limit per game
+int difficulty = 5;
+bool wallsEnabled = true;
+int mapWidth = 0;           // 0 = default size
+int mapHeight = 0;
+int foodItems = 1;
+const char* outPrefix = "heatmap";
+int scale = 8;              // Image pixels per cell
+bool compare = false;       // Also time the same games without counting
+
+// One thread's counts: HEAT_MAPS maps of one counter per cell (the walls
+// map is only filled in after the merge), in one
+// allocation rounded up to whole cache lines, so no two threads ever
+// write to the same line
+struct Histogram {
+    Histogram() : counts(NULL), ticks(0), games(0), cpuNanos(0), plainTicks(0), plainNanos(0) {}
+    ~Histogram() { free(counts); }
+
+    void allocate(size_t cells) {
+        size_t bytes = (HEAT_MAPS * cells * sizeof(uint64_t) + 63) / 64 * 64;
+        void* memory = NULL;
+        if (posix_memalign(&memory, 64, bytes) != 0) abort();
+        memset(memory, 0, bytes);
+        counts = static_cast<uint64_t*>(memory);
+    }
+
+    uint64_t* counts;
+    long ticks;
+    long games;
+    long cpuNanos;   // Thread's CPU time playing them, the fairer clock on a busy machine
+    long plainTicks; // The same without counting, with --compare
+    long plainNanos;
+
+private:
+    Histogram(const Histogram&);
+    void operator=(const Histogram&);
+};
+
+// Play games first to end, counting into counts unless Counting is off.
+// Returns the ticks played.
+template <class Engine, bool Counting>
+long playBatch(Engine& game, Bot& bot, long first, long end, uint64_t* counts) {
+    const int cells = game.mapSize;
+    uint64_t* visits = counts + MAP_VISITS * cells;
+    uint64_t* deaths = counts + MAP_DEATHS * cells;
+    uint64_t* food = counts + MAP_FOOD * cells;
+    long ticks = 0;
+    for (long g = first; g < end; ++g) {
+        game.seed(firstSeed + g);
+        game.initMap();
+        game.running = true;
+        bot.reset(firstSeed + g);
+        if (Counting) {
+            // The food the game starts with
+            for (int c = 0; c < cells; ++c) {
+                if (isFood(game.map[c])) food[c]++;
+            }
+        }
+
+        long t = 0;
+        while (game.running && t < maxTicks) {
+            int ch = bot.play(game, Engine::Walls::wraps);
+            if (ch != NO_KEY) {
+                game.changeDirection(ch);
+            }
+            int length = game.food;
+            game.update();
+            ++t;
+            if (Counting) {
+                visits[game.headypos * game.mapWidth + game.headxpos]++;
+                if (game.food != length && game.lastFoodCell >= 0) food[game.lastFoodCell]++;
+            }
+        }
+        if (Counting && !game.running) {
+            deaths[game.headypos * game.mapWidth + game.headxpos]++;
+        }
+        ticks += t;
+    }
+    return ticks;
+}
+
+// Worker thread: take batches of games until there are none left. With
+// --compare each batch is played twice, without counting and then with,
+// so both see the same games and the same load on the machine.
+template <class Engine>
+void playGames(atomic<long>& nextGame, Histogram& histogram) {
+    Bot* bot = createBot(botName);
+    Engine game;
+    if (mapWidth > 0) {
+        game.resize(mapWidth, mapHeight);
+    }
+    game.foodItems = foodItems;
+    game.difficulty = difficulty;
+    game.wallsEnabled = wallsEnabled;
+    histogram.allocate(game.mapSize);
+
+    const long batch = 16; // Games taken at a time, to keep off the shared counter
+    for (long first = nextGame.fetch_add(batch); first < games; first = nextGame.fetch_add(batch)) {
+        long end = min(first + batch, games);
+        if (compare) {
+            long cpuStart = threadCpuNanos();
+            histogram.plainTicks += playBatch<Engine, false>(game, *bot, first, end, histogram.counts);
+            histogram.plainNanos += threadCpuNanos() - cpuStart;
+        }
+        long cpuStart = threadCpuNanos();
+        histogram.ticks += playBatch<Engine, true>(game, *bot, first, end, histogram.counts);
+        histogram.cpuNanos += threadCpuNanos() - cpuStart;
+        histogram.games += end - first;
+    }
+    delete bot;
+}
+
+// Write one map as a PGM image, each cell scale x scale pixels, shaded on
+// a log scale so the rare cells still show
+static bool writeImage(const string& path, const uint64_t* counts, int width, int height) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == NULL) return false;
+    uint64_t most = *max_element(counts, counts + width * height);
+    fprintf(out, "P5\n%d %d\n255\n", width * scale, height * scale);
+    vector<unsigned char> row(width * scale);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double shade = most > 0 ? log1p((double)counts[y * width + x]) / log1p((double)most) : 0;
+            memset(&row[x * scale], static_cast<int>(shade * 255 + 0.5), scale);
+        }
+        for (int i = 0; i < scale; ++i) {
+            fwrite(&row[0], 1, row.size(), out);
+        }
+    }
+    return fclose(out) == 0;
+}
+
+// Run the batch under one rule set, merge the threads' counts and write them out
+template <class Engine>
+int runHeatmap() {
+    Engine game;
+    if (mapWidth > 0) game.resize(mapWidth, mapHeight);
+    const int width = game.mapWidth;
+    const int height = game.mapHeight;
+    const size_t cells = game.mapSize;
+
+    vector<Histogram> histograms(threads);
+    atomic<long> nextGame(0);
+    struct timespec start = monotonicNow();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(thread(playGames<Engine>, ref(nextGame), ref(histograms[t])));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    double seconds = secondsSince(start);
+
+    // Merge
+    vector<uint64_t> total(HEAT_MAPS * cells, 0);
+    long cpuNanos = 0;
+    long plainTicks = 0;
+    long plainNanos = 0;
+    HeatHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKH", 4);
+    header.version = 1;
+    header.width = width;
+    header.height = height;
+    header.maps = HEAT_MAPS;
+    header.rules = Engine::rules;
+    for (int t = 0; t < threads; ++t) {
+        for (size_t i = 0; i < total.size(); ++i) total[i] += histograms[t].counts[i];
+        header.games += histograms[t].games;
+        header.ticks += histograms[t].ticks;
+        cpuNanos += histograms[t].cpuNanos;
+        plainTicks += histograms[t].plainTicks;
+        plainNanos += histograms[t].plainNanos;
+    }
+
+    // Every game has the same walls, so time next to one is the visits to
+    // the cells next to one, and nothing has to be counted while playing
+    game.wallsEnabled = wallsEnabled;
+    game.initMap();
+    if (Engine::Walls::hasWalls(game)) {
+        for (size_t c = 0; c < cells; ++c) {
+            int x = c % width;
+            int y = c / width;
+            bool nearWall = game.map[c] != WALL &&
+                            ((x > 0 && game.map[c - 1] == WALL) || (x + 1 < width && game.map[c + 1] == WALL) ||
+                             (y > 0 && game.map[c - width] == WALL) || (y + 1 < height && game.map[c + width] == WALL));
+            total[MAP_WALLS * cells + c] = nearWall ? total[MAP_VISITS * cells + c] : 0;
+        }
+    }
+
+    string path = string(outPrefix) + ".heat";
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == NULL || fwrite(&header, sizeof(header), 1, out) != 1 ||
+        fwrite(&total[0], sizeof(uint64_t), total.size(), out) != total.size() || fclose(out) != 0) {
+        perror(path.c_str());
+        return 1;
+    }
+    for (int m = 0; m < HEAT_MAPS; ++m) {
+        string image = string(outPrefix) + "-" + heatMapNames[m] + ".pgm";
+        if (!writeImage(image, &total[m * cells], width, height)) {
+            perror(image.c_str());
+            return 1;
+        }
+        uint64_t sum = 0;
+        for (size_t i = 0; i < cells; ++i) sum += total[m * cells + i];
+        printf("%-7s %14llu counted, %s\n", heatMapNames[m], (unsigned long long)sum, image.c_str());
+    }
+
+    double rate = header.ticks / (cpuNanos / 1e9);
+    printf("%llu games, %llu ticks in %.2f s on %d threads, %.0f ticks per CPU second\n",
+           (unsigned long long)header.games, (unsigned long long)header.ticks, seconds, threads, rate);
+    if (compare) {
+        double plainRate = plainTicks / (plainNanos / 1e9);
+        printf("Without counting: %.0f ticks per CPU second, counting costs %.1f%%\n", plainRate,
+               100.0 * (plainRate - rate) / plainRate);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rules = "snake6";
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) {
+            botName = argv[++i];
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = atol(argv[++i]);
+            ok = games > 0;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            firstSeed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules = argv[++i];
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && i + 1 < argc) {
+            wallsEnabled = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            ok = sscanf(argv[++i], "%dx%d", &mapWidth, &mapHeight) == 2 && mapWidth >= 3 && mapHeight >= 3 &&
+                 mapWidth <= 4096 && mapHeight <= 4096;
+        } else if (strcmp(argv[i], "--food") == 0 && i + 1 < argc) {
+            foodItems = atoi(argv[++i]);
+            if (foodItems < 1) foodItems = 1;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atoi(argv[++i]);
+            if (scale < 1) scale = 1;
+        } else if (strcmp(argv[i], "--compare") == 0) {
+            compare = true;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outPrefix = argv[++i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Usage: %s [--bot NAME] [--games N] [--seed N] [--threads N] [--rules snake|snake2..snake7]\n"
+                        "       [--ticks N] [--difficulty 1-9] [--walls y|n] [--size WxH] [--food N]\n"
+                        "       [--scale PIXELS] [--compare] [-o PREFIX]\n"
+                        "Bots: %s\n", argv[0], botNames());
+        return 1;
+    }
+    Bot* bot = createBot(botName);
+    if (bot == NULL) {
+        fprintf(stderr, "Unknown bot: %s (have: %s)\n", botName, botNames());
+        return 1;
+    }
+    delete bot;
+    if (threads < 1) {
+        threads = thread::hardware_concurrency();
+        if (threads < 1) threads = 1;
+    }
+
+    printf("Rules %s, bot %s, seeds %llu-%llu, difficulty %d, walls %s\n", rules, botName,
+           (unsigned long long)firstSeed, (unsigned long long)(firstSeed + games - 1), difficulty,
+           wallsEnabled ? "on" : "off");
+    if (strcmp(rules, "snake") == 0) return runHeatmap<SnakeEngine>();
+    if (strcmp(rules, "snake2") == 0) return runHeatmap<Snake2Engine>();
+    if (strcmp(rules, "snake3") == 0) return runHeatmap<Snake3Engine>();
+    if (strcmp(rules, "snake4") == 0) return runHeatmap<Snake4Engine>();
+    if (strcmp(rules, "snake5") == 0) return runHeatmap<Snake5Engine>();
+    if (strcmp(rules, "snake6") == 0) return runHeatmap<Snake6Engine>();
+    if (strcmp(rules, "snake7") == 0) return runHeatmap<Snake7Engine>();
+    fprintf(stderr, "Unknown rules: %s\n", rules);
+    return 1;
+}
@@ -0,0 +1,115 @@
+#include "level.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+LevelPack::LevelPack() : data(NULL), size(0), levels(0) {
+}
+
+LevelPack::~LevelPack() {
+    close();
+}
+
+bool LevelPack::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(LevelPackHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size = st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+    data = static_cast<const unsigned char*>(mapping);
+
+    const LevelPackHeader* header = reinterpret_cast<const LevelPackHeader*>(data);
+    if (memcmp(header->magic, "SNKL", 4) != 0 || header->version != LEVEL_PACK_VERSION ||
+        sizeof(LevelPackHeader) + (size_t)header->count * sizeof(LevelEntry) > size) {
+        close();
+        return false;
+    }
+
+    // Check every level once so level() can trust the file
+    const LevelEntry* entries = reinterpret_cast<const LevelEntry*>(data + sizeof(LevelPackHeader));
+    for (uint32_t i = 0; i < header->count; ++i) {
+        uint64_t offset = entries[i].offset;
+        if (offset % 8 != 0 || offset > size - sizeof(LevelRecord) ||
+            memchr(entries[i].name, '\0', sizeof(entries[i].name)) == NULL) {
+            close();
+            return false;
+        }
+        const LevelRecord* record = reinterpret_cast<const LevelRecord*>(data + offset);
+        uint64_t cells = (uint64_t)record->width * record->height;
+        bool spawnInside = record->spawnx >= 0 && record->spawnx < (int64_t)record->width &&
+                           record->spawny >= 0 && record->spawny < (int64_t)record->height;
+        if (record->width < 3 || record->height < 3 || cells > (1 << 24) || !spawnInside ||
+            record->spawnDirection < 0 || record->spawnDirection > 3) {
+            close();
+            return false;
+        }
+
+        // The walls and zones must fit in what follows the record; take each
+        // part off what is left rather than summing, so nothing can wrap
+        uint64_t left = size - offset - sizeof(LevelRecord);
+        uint64_t wallBytes = wallWords(record->width, record->height) * 8;
+        if (wallBytes > left || record->zoneCount > (left - wallBytes) / sizeof(FoodZone)) {
+            close();
+            return false;
+        }
+
+        // The snake can't start in a wall and food can't go outside the map
+        Level checked = level(i);
+        bool ok = !checked.isWall(checked.spawny * checked.width + checked.spawnx);
+        for (int z = 0; z < checked.zoneCount && ok; ++z) {
+            const FoodZone& zone = checked.zones[z];
+            ok = zone.width > 0 && zone.height > 0 && zone.x + zone.width <= checked.width &&
+                 zone.y + zone.height <= checked.height;
+        }
+        if (!ok) {
+            close();
+            return false;
+        }
+    }
+    levels = header->count;
+    return true;
+}
+
+void LevelPack::close() {
+    if (data != NULL) munmap(const_cast<unsigned char*>(data), size);
+    data = NULL;
+    size = 0;
+    levels = 0;
+}
+
+Level LevelPack::level(int index) const {
+    const LevelEntry* entries = reinterpret_cast<const LevelEntry*>(data + sizeof(LevelPackHeader));
+    const unsigned char* p = data + entries[index].offset;
+    const LevelRecord* record = reinterpret_cast<const LevelRecord*>(p);
+
+    Level level;
+    level.name = entries[index].name;
+    level.width = record->width;
+    level.height = record->height;
+    level.spawnx = record->spawnx;
+    level.spawny = record->spawny;
+    level.spawnDirection = record->spawnDirection;
+    level.walls = reinterpret_cast<const uint64_t*>(p + sizeof(LevelRecord));
+    level.zoneCount = record->zoneCount;
+    level.zones = reinterpret_cast<const FoodZone*>(p + sizeof(LevelRecord) +
+                                                    wallWords(level.width, level.height) * 8);
+    return level;
+}
+
+int LevelPack::find(const char* name) const {
+    const LevelEntry* entries = reinterpret_cast<const LevelEntry*>(data + sizeof(LevelPackHeader));
+    for (int i = 0; i < levels; ++i) {
+        if (strcmp(entries[i].name, name) == 0) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,92 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Level pack layout (native byte order, every part 8-byte aligned):
+//
+//   LevelPackHeader
+//   LevelEntry[count]             directory: name and file offset of each level
+//   for each level:
+//     LevelRecord
+//     uint64_t walls[(width * height + 63) / 64]   bit i set = cell i is a wall
+//     FoodZone zones[zoneCount]   (padded to 8 bytes)
+//
+// Packs are built from text by levelc and read in place from a memory
+// mapping, so opening one costs the same however many levels it holds.
+
+struct LevelPackHeader {
+    char magic[4];        // "SNKL"
+    uint32_t version;
+    uint32_t count;       // Number of levels
+    uint32_t reserved;
+};
+
+struct LevelEntry {
+    uint64_t offset;      // File offset of the LevelRecord
+    char name[24];        // NUL-terminated
+};
+
+struct LevelRecord {
+    uint32_t width;
+    uint32_t height;
+    int32_t spawnx;       // Where the snake's head starts
+    int32_t spawny;
+    int32_t spawnDirection; // 0 up, 1 right, 2 down, 3 left
+    uint32_t zoneCount;   // Food zones; 0 means food can go anywhere
+};
+
+// A rectangle food is placed in
+struct FoodZone {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+const uint32_t LEVEL_PACK_VERSION = 1;
+
+// Number of 64-bit words in a wall bitmap
+inline size_t wallWords(int width, int height) {
+    return (static_cast<size_t>(width) * height + 63) / 64;
+}
+
+// One level, pointing straight into the pack's mapping
+struct Level {
+    const char* name;
+    int width;
+    int height;
+    int spawnx;
+    int spawny;
+    int spawnDirection;
+    const uint64_t* walls;
+    int zoneCount;
+    const FoodZone* zones;
+
+    bool isWall(int cell) const { return (walls[cell >> 6] >> (cell & 63)) & 1; }
+};
+
+// A memory-mapped level pack
+class LevelPack {
+public:
+    LevelPack();
+    ~LevelPack();
+
+    // Map and validate a pack. Returns false if it can't be used.
+    bool open(const char* path);
+    void close();
+
+    int count() const { return levels; }
+    Level level(int index) const;
+
+    // Index of the level with this name, or -1
+    int find(const char* name) const;
+
+private:
+    const unsigned char* data;
+    size_t size;
+    int levels;
+};
+
+#endif
@@ -0,0 +1,236 @@
+// Level compiler: turns text level descriptions into a binary level pack.
+//
+// Text format, any number of levels per file:
+//
+//   # Comment (only between levels, inside one '#' is a wall)
+//   level NAME
+//   zone X Y WIDTH HEIGHT     (optional, repeatable: food only appears in zones)
+//   ########
+//   #..>...#                  '#' wall, '.' or ' ' empty,
+//   ########                  '^' '>' 'v' '<' where the snake starts and its direction
+//   end
+//
+// Rows shorter than the widest one are padded with empty cells. Without a
+// start marker the snake starts in the middle, heading up.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "level.h"
+
+using namespace std;
+
+// A level as read from text
+struct TextLevel {
+    string name;
+    vector<string> rows;
+    vector<FoodZone> zones;
+    const char* file;
+    int line;
+};
+
+// Report an error in an input file
+static bool fail(const char* file, int line, const char* message) {
+    fprintf(stderr, "%s:%d: %s\n", file, line, message);
+    return false;
+}
+
+// Read every level in a text file
+static bool readLevels(const char* path, vector<TextLevel>& levels) {
+    FILE* in = fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        return false;
+    }
+    char buf[4096];
+    int lineNumber = 0;
+    bool inLevel = false;
+    bool ok = true;
+    while (ok && fgets(buf, sizeof(buf), in) != NULL) {
+        ++lineNumber;
+        string line(buf);
+        while (!line.empty() && (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r')) {
+            line.erase(line.size() - 1);
+        }
+
+        if (!inLevel) {
+            if (line.empty() || line[0] == '#') continue;
+            char name[64];
+            if (sscanf(line.c_str(), "level %63s", name) != 1) {
+                ok = fail(path, lineNumber, "expected 'level NAME'");
+                break;
+            }
+            if (strlen(name) >= sizeof(((LevelEntry*)0)->name)) {
+                ok = fail(path, lineNumber, "level name too long");
+                break;
+            }
+            TextLevel level;
+            level.name = name;
+            level.file = path;
+            level.line = lineNumber;
+            levels.push_back(level);
+            inLevel = true;
+            continue;
+        }
+
+        TextLevel& level = levels.back();
+        int x, y, w, h;
+        if (line == "end") {
+            inLevel = false;
+        } else if (line.compare(0, 5, "zone ") == 0) {
+            if (sscanf(line.c_str(), "zone %d %d %d %d", &x, &y, &w, &h) != 4 ||
+                x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > 65535 || y + h > 65535) {
+                ok = fail(path, lineNumber, "expected 'zone X Y WIDTH HEIGHT'");
+                break;
+            }
+            FoodZone zone;
+            zone.x = x;
+            zone.y = y;
+            zone.width = w;
+            zone.height = h;
+            level.zones.push_back(zone);
+        } else {
+            level.rows.push_back(line);
+        }
+    }
+    if (ok && inLevel) {
+        ok = fail(path, lineNumber, "missing 'end'");
+    }
+    fclose(in);
+    return ok;
+}
+
+// Turn a text level into its binary record
+static bool compileLevel(const TextLevel& text, vector<uint64_t>& out) {
+    int height = text.rows.size();
+    int width = 0;
+    for (size_t i = 0; i < text.rows.size(); ++i) {
+        if ((int)text.rows[i].size() > width) width = text.rows[i].size();
+    }
+    if (width < 3 || height < 3) {
+        return fail(text.file, text.line, "level must be at least 3x3");
+    }
+
+    LevelRecord record;
+    memset(&record, 0, sizeof(record));
+    record.width = width;
+    record.height = height;
+    record.spawnx = -1;
+    record.zoneCount = text.zones.size();
+    vector<uint64_t> walls(wallWords(width, height), 0);
+    for (int y = 0; y < height; ++y) {
+        const string& row = text.rows[y];
+        for (int x = 0; x < (int)row.size(); ++x) {
+            int cell = y * width + x;
+            const char* arrows = "^>v<";
+            const char* arrow = strchr(arrows, row[x]);
+            if (row[x] == '#') {
+                walls[cell >> 6] |= 1ULL << (cell & 63);
+            } else if (arrow != NULL) {
+                if (record.spawnx >= 0) {
+                    return fail(text.file, text.line + 1 + y, "more than one start marker");
+                }
+                record.spawnx = x;
+                record.spawny = y;
+                record.spawnDirection = arrow - arrows;
+            } else if (row[x] != '.' && row[x] != ' ') {
+                return fail(text.file, text.line + 1 + y, "unknown map character");
+            }
+        }
+    }
+    if (record.spawnx < 0) {
+        record.spawnx = width / 2;
+        record.spawny = height / 2;
+        record.spawnDirection = 0;
+        int cell = record.spawny * width + record.spawnx;
+        if ((walls[cell >> 6] >> (cell & 63)) & 1) {
+            return fail(text.file, text.line, "no start marker and the middle is a wall");
+        }
+    }
+    for (size_t z = 0; z < text.zones.size(); ++z) {
+        const FoodZone& zone = text.zones[z];
+        if (zone.x + zone.width > width || zone.y + zone.height > height) {
+            return fail(text.file, text.line, "food zone outside the map");
+        }
+    }
+
+    // Record, bitmap and zones, each padded to whole 64-bit words
+    size_t recordWords = sizeof(record) / 8;
+    size_t zoneWords = (text.zones.size() * sizeof(FoodZone) + 7) / 8;
+    out.assign(recordWords + walls.size() + zoneWords, 0);
+    memcpy(&out[0], &record, sizeof(record));
+    memcpy(&out[recordWords], &walls[0], walls.size() * 8);
+    if (!text.zones.empty()) {
+        memcpy(&out[recordWords + walls.size()], &text.zones[0], text.zones.size() * sizeof(FoodZone));
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* output = NULL;
+    vector<const char*> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (output == NULL || inputs.empty()) {
+        fprintf(stderr, "Usage: %s LEVELS.txt... -o PACK.snl\n", argv[0]);
+        return 1;
+    }
+
+    vector<TextLevel> levels;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!readLevels(inputs[i], levels)) return 1;
+    }
+    for (size_t i = 0; i < levels.size(); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (levels[i].name == levels[j].name) {
+                fail(levels[i].file, levels[i].line, "duplicate level name");
+                return 1;
+            }
+        }
+    }
+
+    // Compile everything first so the directory can hold final offsets
+    vector<vector<uint64_t> > records(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        if (!compileLevel(levels[i], records[i])) return 1;
+    }
+
+    LevelPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKL", 4);
+    header.version = LEVEL_PACK_VERSION;
+    header.count = levels.size();
+
+    vector<LevelEntry> entries(levels.size());
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(LevelEntry);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        memset(&entries[i], 0, sizeof(LevelEntry));
+        entries[i].offset = offset;
+        strcpy(entries[i].name, levels[i].name.c_str());
+        offset += records[i].size() * 8;
+    }
+
+    FILE* out = fopen(output, "wb");
+    if (out == NULL) {
+        perror(output);
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    if (!entries.empty()) fwrite(&entries[0], sizeof(LevelEntry), entries.size(), out);
+    for (size_t i = 0; i < records.size(); ++i) {
+        fwrite(&records[i][0], 8, records[i].size(), out);
+    }
+    if (ferror(out) || fclose(out) != 0) {
+        perror(output);
+        return 1;
+    }
+    printf("%s: %zu levels\n", output, levels.size());
+    return 0;
+}
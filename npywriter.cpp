@@ -0,0 +1,153 @@
+#include "npywriter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "timing.h"
+
+NpyWriter::NpyWriter()
+    : width(0), height(0), planeSize(0), chunkTicks(0), filling(0), nextChunk(0), stop(false), failed(false) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+NpyWriter::~NpyWriter() {
+    close();
+}
+
+void NpyWriter::open(const char* prefix, int width, int height, int chunkTicks) {
+    this->prefix = prefix;
+    this->width = width;
+    this->height = height;
+    this->chunkTicks = chunkTicks;
+    planeSize = PLANES * width * height;
+    for (int b = 0; b < 2; ++b) {
+        Batch& batch = batches[b];
+        batch.planes.resize((size_t)chunkTicks * planeSize);
+        batch.actions.resize(chunkTicks);
+        batch.rewards.resize(chunkTicks);
+        batch.dones.resize(chunkTicks);
+        batch.truncations.resize(chunkTicks);
+        batch.ticks = 0;
+        batch.full = false;
+    }
+    filling = 0;
+    nextChunk = 0;
+    stop = false;
+    failed = false;
+    writer = std::thread(&NpyWriter::writeBatches, this);
+}
+
+void NpyWriter::add(int action, float reward, bool done, bool truncated) {
+    Batch& batch = batches[filling];
+    batch.actions[batch.ticks] = action;
+    batch.rewards[batch.ticks] = reward;
+    batch.dones[batch.ticks] = done;
+    batch.truncations[batch.ticks] = truncated;
+    ++batch.ticks;
+    ++stats.ticks;
+    if (batch.ticks == chunkTicks) {
+        handOver();
+    }
+}
+
+void NpyWriter::handOver() {
+    std::unique_lock<std::mutex> guard(lock);
+    batches[filling].chunk = nextChunk++;
+    batches[filling].full = true;
+    changed.notify_all();
+    filling ^= 1;
+    if (batches[filling].full) {
+        // The writer is still on the other batch: the disk is behind
+        struct timespec start = monotonicNow();
+        changed.wait(guard, [this] { return !batches[filling].full; });
+        stats.waitNanos += (long)(secondsSince(start) * 1e9);
+    }
+    batches[filling].ticks = 0;
+}
+
+bool NpyWriter::close() {
+    if (!writer.joinable()) return !failed;
+    if (batches[filling].ticks > 0) {
+        handOver();
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+        changed.notify_all();
+    }
+    writer.join();
+    return !failed;
+}
+
+void NpyWriter::writeBatches() {
+    int next = 0; // Batches become full in turn
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [this, next] { return batches[next].full || stop; });
+            if (!batches[next].full) return;
+        }
+
+        // Write without holding the lock; the game thread is on the other batch
+        const Batch& batch = batches[next];
+        char ticks[32];
+        snprintf(ticks, sizeof(ticks), "%d,", batch.ticks);
+        char planeShape[64];
+        snprintf(planeShape, sizeof(planeShape), "%d, %d, %d, %d", batch.ticks, PLANES, height, width);
+        bool ok = writeArray(batch.chunk, "planes", "f4", planeShape, &batch.planes[0],
+                             (size_t)batch.ticks * planeSize * sizeof(float)) &&
+                  writeArray(batch.chunk, "action", "i1", ticks, &batch.actions[0], batch.ticks) &&
+                  writeArray(batch.chunk, "reward", "f4", ticks, &batch.rewards[0], batch.ticks * sizeof(float)) &&
+                  writeArray(batch.chunk, "done", "b1", ticks, &batch.dones[0], batch.ticks) &&
+                  writeArray(batch.chunk, "truncated", "b1", ticks, &batch.truncations[0], batch.ticks);
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (!ok) failed = true;
+        stats.chunks++;
+        batches[next].full = false;
+        changed.notify_all();
+        next ^= 1;
+    }
+}
+
+bool NpyWriter::writeArray(long chunk, const char* name, const char* type, const std::string& shape,
+                           const void* data, size_t size) {
+    // .npy header: magic, version 1.0, the length of the rest, then a
+    // Python dict describing the array, padded so the data starts on a
+    // 64-byte boundary
+    static const uint16_t probe = 1;
+    bool little = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+    std::string dict = std::string("{'descr': '") + (type[0] == 'f' ? (little ? "<" : ">") : "|") + type +
+                       "', 'fortran_order': False, 'shape': (" + shape + "), }";
+    size_t length = 10 + dict.size() + 1;
+    dict.append((64 - length % 64) % 64, ' ');
+    dict += '\n';
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += static_cast<char>(dict.size() & 0xff);
+    header += static_cast<char>(dict.size() >> 8);
+    header += dict;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s-%05ld-%s.npy", prefix.c_str(), chunk, name);
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    bool ok = write(fd, header.data(), header.size()) == static_cast<ssize_t>(header.size());
+    const char* bytes = static_cast<const char*>(data);
+    for (size_t done = 0; ok && done < size; ) {
+        ssize_t n = write(fd, bytes + done, size - done);
+        if (n <= 0) {
+            ok = false;
+        } else {
+            done += n;
+        }
+    }
+    if (!ok) perror(path);
+    ok = ::close(fd) == 0 && ok;
+    stats.bytes += header.size() + size;
+    return ok;
+}
@@ -0,0 +1,91 @@
+#ifndef NPYWRITER_H
+#define NPYWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "planes.h"
+
+// Writes training data, one record per tick, as chunks of NumPy .npy files.
+// Chunk N of PREFIX is five files, each with one entry per tick:
+//
+//   PREFIX-0000N-planes.npy   float32 [ticks, PLANES, height, width]   the board before the move
+//   PREFIX-0000N-action.npy   int8 [ticks]      direction moved, 0 up, 1 right, 2 down, 3 left
+//   PREFIX-0000N-reward.npy   float32 [ticks]   points the move scored
+//   PREFIX-0000N-done.npy     bool [ticks]      the game ended with the move
+//   PREFIX-0000N-truncated.npy bool [ticks]     the tick limit stopped the game after the move
+//
+// The game thread fills one batch while a background thread writes the
+// other. Only one batch is ever in flight, so whenever writing a chunk
+// takes longer than playing one the game thread blocks until it is done;
+// stats.waitNanos says for how long.
+class NpyWriter {
+public:
+    NpyWriter();
+    ~NpyWriter();
+
+    // Start writing chunks of chunkTicks ticks of a width x height board
+    void open(const char* prefix, int width, int height, int chunkTicks);
+
+    // Where to encode the next tick's planes
+    float* planes() { return &batches[filling].planes[batches[filling].ticks * planeSize]; }
+
+    // Finish the tick whose planes were just encoded
+    void add(int action, float reward, bool done, bool truncated);
+
+    // Write what is left and stop the writer thread. Returns false if
+    // anything couldn't be written.
+    bool close();
+
+    struct Stats {
+        long ticks;
+        long chunks;
+        long bytes;      // Written to the files, headers included
+        long waitNanos;  // Time the game thread waited for a batch to be free
+    };
+    Stats stats;
+
+private:
+    // One chunk's worth of ticks
+    struct Batch {
+        std::vector<float> planes;
+        std::vector<int8_t> actions;
+        std::vector<float> rewards;
+        std::vector<uint8_t> dones;
+        std::vector<uint8_t> truncations;
+        int ticks;
+        long chunk;      // Which chunk it becomes
+        bool full;       // Handed to the writer thread, not yet written
+    };
+
+    // Hand the batch being filled to the writer and move to the other one
+    void handOver();
+
+    // Writer thread: write full batches in turn until told to stop
+    void writeBatches();
+
+    // Write one array as a .npy file. Returns false on error.
+    bool writeArray(long chunk, const char* name, const char* type, const std::string& shape,
+                    const void* data, size_t size);
+
+    std::string prefix;
+    int width;
+    int height;
+    int planeSize;       // Floats per tick
+    int chunkTicks;
+    Batch batches[2];
+    int filling;         // Batch the game thread is filling
+    long nextChunk;
+
+    std::mutex lock;
+    std::condition_variable changed; // A batch became full or was written, or stop was set
+    bool stop;
+    bool failed;
+    std::thread writer;
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include "options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+#include "replay.h"
+
+Options::Options()
+    : headless(false), maxTicks(0), rendererName("curses"), threaded(false), renderFps(30),
+      frameSkip(true), colour(false), fast(false), difficulty(0), walls(-1), streamPath(NULL), streamFd(-1), eventsPath(NULL),
+      recordPath(NULL), keyframeInterval(1000), replayPath(NULL), startTick(0),
+      levelPath(NULL), levelName(NULL), botName(NULL), botDeadlineMicros(0), botCacheEntries(0), scoresPath(NULL), mapWidth(0), mapHeight(0), foodItems(1),
+      session(false), sessionGames(0), savePath("snake.sav"), resumePath(NULL) {
+    seed = static_cast<uint64_t>(time(0)) ^ (getpid() * 0x9e3779b97f4a7c15ULL);
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--headless] [--renderer curses|ansi|halfblock] [--threaded] [--fps N]\n"
+            "       [--no-frame-skip] [--colour] [--ticks N] [--fast] [--seed N]\n"
+            "       [--difficulty 1-9] [--walls y|n] [--stream PATH | --stream-fd FD]\n"
+            "       [--events FILE]\n"
+            "       [--record FILE [--keyframe-interval N]]\n"
+            "       [--replay FILE [--seek TICK]] [--level PACK [--level-name NAME]]\n"
+            "       [--size WxH] [--food N] [--food-values V,V,...] [--scores FILE]\n"
+            "       [--bot greedy|random|flood|path|bfs|net:FILE|./PLUGIN.so\n"
+            "       [--bot-deadline MICROS] [--bot-cache ENTRIES]]\n"
+            "       [--session [--games N]] [--save FILE] [--resume FILE]\n",
+            program);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--headless") == 0) {
+            options.headless = true;
+        } else if (strcmp(arg, "--renderer") == 0 && hasValue) {
+            options.rendererName = argv[++i];
+        } else if (strcmp(arg, "--threaded") == 0) {
+            options.threaded = true;
+        } else if (strcmp(arg, "--fps") == 0 && hasValue) {
+            options.renderFps = atoi(argv[++i]);
+            if (options.renderFps < 1) options.renderFps = 1;
+        } else if (strcmp(arg, "--colour") == 0 || strcmp(arg, "--color") == 0) {
+            options.colour = true;
+        } else if (strcmp(arg, "--no-frame-skip") == 0) {
+            options.frameSkip = false;
+        } else if (strcmp(arg, "--ticks") == 0 && hasValue) {
+            options.maxTicks = atol(argv[++i]);
+        } else if (strcmp(arg, "--fast") == 0) {
+            options.fast = true;
+        } else if (strcmp(arg, "--seed") == 0 && hasValue) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--difficulty") == 0 && hasValue) {
+            options.difficulty = atoi(argv[++i]);
+            if (options.difficulty < 1 || options.difficulty > 9) {
+                fprintf(stderr, "Difficulty must be 1-9\n");
+                return false;
+            }
+        } else if (strcmp(arg, "--walls") == 0 && hasValue) {
+            char choice = argv[++i][0];
+            options.walls = (choice == 'y' || choice == 'Y') ? 1 : 0;
+        } else if (strcmp(arg, "--stream") == 0 && hasValue) {
+            options.streamPath = argv[++i];
+        } else if (strcmp(arg, "--stream-fd") == 0 && hasValue) {
+            options.streamFd = atoi(argv[++i]);
+        } else if (strcmp(arg, "--events") == 0 && hasValue) {
+            options.eventsPath = argv[++i];
+        } else if (strcmp(arg, "--record") == 0 && hasValue) {
+            options.recordPath = argv[++i];
+        } else if (strcmp(arg, "--keyframe-interval") == 0 && hasValue) {
+            options.keyframeInterval = atoi(argv[++i]);
+            if (options.keyframeInterval < 1) options.keyframeInterval = 1;
+        } else if (strcmp(arg, "--replay") == 0 && hasValue) {
+            options.replayPath = argv[++i];
+        } else if (strcmp(arg, "--seek") == 0 && hasValue) {
+            options.startTick = atol(argv[++i]);
+        } else if (strcmp(arg, "--level") == 0 && hasValue) {
+            options.levelPath = argv[++i];
+        } else if (strcmp(arg, "--level-name") == 0 && hasValue) {
+            options.levelName = argv[++i];
+        } else if (strcmp(arg, "--bot") == 0 && hasValue) {
+            options.botName = argv[++i];
+        } else if (strcmp(arg, "--bot-deadline") == 0 && hasValue) {
+            options.botDeadlineMicros = atol(argv[++i]);
+        } else if (strcmp(arg, "--bot-cache") == 0 && hasValue) {
+            options.botCacheEntries = atol(argv[++i]);
+        } else if (strcmp(arg, "--scores") == 0 && hasValue) {
+            options.scoresPath = argv[++i];
+        } else if (strcmp(arg, "--size") == 0 && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &options.mapWidth, &options.mapHeight) != 2 ||
+                options.mapWidth < 3 || options.mapHeight < 3 ||
+                options.mapWidth > 4096 || options.mapHeight > 4096) {
+                fprintf(stderr, "Size must be WIDTHxHEIGHT, 3x3 to 4096x4096\n");
+                return false;
+            }
+        } else if (strcmp(arg, "--food") == 0 && hasValue) {
+            options.foodItems = atoi(argv[++i]);
+            if (options.foodItems < 1) options.foodItems = 1;
+        } else if (strcmp(arg, "--food-values") == 0 && hasValue) {
+            // Comma separated, a value listed twice comes up twice as often
+            options.foodValues.clear();
+            for (const char* p = argv[++i]; *p != '\0'; ) {
+                char* end;
+                long value = strtol(p, &end, 10);
+                if (end == p || value < 1 || value > 9 || (*end != ',' && *end != '\0')) {
+                    fprintf(stderr, "Food values must be 1-9, separated by commas\n");
+                    return false;
+                }
+                if (options.foodValues.size() == (size_t)REPLAY_FOOD_VALUES) {
+                    fprintf(stderr, "At most %d food values\n", REPLAY_FOOD_VALUES);
+                    return false;
+                }
+                options.foodValues.push_back(value);
+                p = *end == ',' ? end + 1 : end;
+            }
+        } else if (strcmp(arg, "--session") == 0) {
+            options.session = true;
+        } else if (strcmp(arg, "--games") == 0 && hasValue) {
+            options.sessionGames = atol(argv[++i]);
+            if (options.sessionGames < 1) options.sessionGames = 1;
+        } else if (strcmp(arg, "--save") == 0 && hasValue) {
+            options.savePath = argv[++i];
+        } else if (strcmp(arg, "--resume") == 0 && hasValue) {
+            options.resumePath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (options.session && options.recordPath != NULL) {
+        fprintf(stderr, "A replay holds one game; --record can't be used with --session\n");
+        return false;
+    }
+    if (options.resumePath != NULL && options.replayPath != NULL) {
+        fprintf(stderr, "--resume starts a game; it can't be used with --replay\n");
+        return false;
+    }
+    if (options.session && options.headless && options.sessionGames == 0) {
+        options.sessionGames = 10; // Nobody is there to press q
+    }
+    return true;
+}
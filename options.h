@@ -0,0 +1,48 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdint>
+#include <vector>
+
+// Command line options shared by every variant of the game
+struct Options {
+    Options();
+
+    bool headless;            // Run without a terminal, steered by the autopilot
+    long maxTicks;            // Stop after this many ticks (0 = run forever)
+    const char* rendererName; // Terminal backend
+    bool threaded;            // Draw on a separate render thread
+    int renderFps;            // Most frames per second the render thread draws
+    bool frameSkip;           // Draw fewer frames while the terminal is behind
+    bool colour;              // Draw the snake, food and walls in colour
+    bool fast;                // Don't wait between ticks
+    uint64_t seed;            // Random seed
+    int difficulty;           // 1-9, or 0 to ask
+    int walls;                // 1 on, 0 off, -1 to ask
+    const char* streamPath;   // Spectator stream file or FIFO
+    int streamFd;             // Spectator stream descriptor (-1 = none)
+    const char* eventsPath;   // Event log file (NULL = none)
+    const char* recordPath;   // Replay to record
+    int keyframeInterval;     // Ticks between replay keyframes
+    const char* replayPath;   // Replay to play back
+    long startTick;           // Where playback starts
+    const char* levelPath;    // Level pack to play on
+    const char* levelName;    // Level in the pack (NULL = the first)
+    const char* botName;      // Bot that plays instead of the player
+    long botDeadlineMicros;   // Longest a bot may think per move (0 = forever)
+    long botCacheEntries;     // Decisions the bot remembers by position (0 = none)
+    const char* scoresPath;   // High-score log to add the result to
+    int mapWidth;             // Map size without a level (0 = default)
+    int mapHeight;
+    int foodItems;            // Pieces of food on the map at once
+    std::vector<int> foodValues; // What new food can be worth (empty = 1)
+    bool session;             // Play again straight after game over
+    long sessionGames;        // Games in a session (0 = until the player quits)
+    const char* savePath;     // Where the save key writes the game
+    const char* resumePath;   // Saved game to carry on with (NULL = new game)
+};
+
+// Fill options from the command line. Prints usage and returns false on error.
+bool parseOptions(int argc, char** argv, Options& options);
+
+#endif
@@ -0,0 +1,49 @@
+#include "planes.h"
+
+#include <cstring>
+
+#include "game.h"
+
+void encodePlanesScalar(const Game& game, float* planes) {
+    int cells = game.mapSize;
+    float* body = planes + PLANE_BODY * cells;
+    float* food = planes + PLANE_FOOD * cells;
+    float* walls = planes + PLANE_WALLS * cells;
+    float scale = 1.0f / game.food;
+    for (int i = 0; i < cells; ++i) {
+        int value = game.map[i];
+        body[i] = value > 0 ? value * scale : 0.0f;
+        food[i] = isFood(value) ? 1.0f : 0.0f;
+        walls[i] = value == WALL ? 1.0f : 0.0f;
+    }
+    float* head = planes + PLANE_HEAD * cells;
+    memset(head, 0, cells * sizeof(float));
+    head[game.headypos * game.mapWidth + game.headxpos] = 1.0f;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// In planes_avx2.cpp, built for AVX2 whatever the compiler flags
+void encodePlanesAvx2(const Game& game, float* planes);
+
+// Whether the CPU can run it, asked once
+static bool haveAvx2() {
+    static const bool have = __builtin_cpu_supports("avx2");
+    return have;
+}
+#else
+static bool haveAvx2() { return false; }
+#endif
+
+void encodePlanes(const Game& game, float* planes) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (haveAvx2()) {
+        encodePlanesAvx2(game, planes);
+        return;
+    }
+#endif
+    encodePlanesScalar(game, planes);
+}
+
+const char* planesKernel() {
+    return haveAvx2() ? "avx2" : "scalar";
+}
@@ -0,0 +1,24 @@
+#ifndef PLANES_H
+#define PLANES_H
+
+struct Game;
+
+// A game's board as planes of floats, one value per cell each, for
+// learning from (see ./dataset):
+const int PLANE_BODY = 0;   // Body cells: ticks left before the tail leaves, over the length (head 1)
+const int PLANE_HEAD = 1;   // 1 on the head
+const int PLANE_FOOD = 2;   // 1 on food of any value
+const int PLANE_WALLS = 3;  // 1 on walls
+const int PLANES = 4;
+
+// Fill planes[PLANES][mapHeight][mapWidth] from the game's map, with the
+// AVX2 kernel if the CPU has AVX2 and encodePlanesScalar() otherwise
+void encodePlanes(const Game& game, float* planes);
+
+// The same without vector instructions
+void encodePlanesScalar(const Game& game, float* planes);
+
+// Name of the kernel encodePlanes() uses, "avx2" or "scalar"
+const char* planesKernel();
+
+#endif
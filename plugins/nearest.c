@@ -0,0 +1,63 @@
+/*
+ * Example bot plugin: heads for the nearest food, never straight into a
+ * wall or its own body. Build with make, then:
+ *
+ *   ./snake2 --bot ./plugins/nearest.so
+ */
+#include <stdlib.h>
+
+#include "../snakebot.h"
+
+int snake_bot_abi(void) {
+    return SNAKE_BOT_ABI;
+}
+
+/* Whether a tile is food of any value */
+static int isFood(int32_t tile) {
+    return tile == SNAKE_FOOD || tile < SNAKE_FOOD_VALUE_BASE - 1;
+}
+
+int decide(const SnakeView* view) {
+    static const int dx[4] = {0, 1, 0, -1};
+    static const int dy[4] = {-1, 0, 1, 0};
+    static const char keys[4] = {SNAKE_UP, SNAKE_RIGHT, SNAKE_DOWN, SNAKE_LEFT};
+    int size = view->width * view->height;
+    int foodx = view->headx, foody = view->heady;
+    int best = -1, bestDistance = size;
+    int i, d;
+
+    /* Nearest food by a plain scan of the board */
+    for (i = 0; i < size; ++i) {
+        if (isFood(view->cells[i])) {
+            int distance = abs(i % view->width - view->headx) + abs(i / view->width - view->heady);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                foodx = i % view->width;
+                foody = i / view->width;
+            }
+        }
+    }
+
+    /* The safe move that gets closest to it */
+    bestDistance = size;
+    for (d = 0; d < 4; ++d) {
+        int x = view->headx + dx[d];
+        int y = view->heady + dy[d];
+        int tile, distance;
+        if (d == (view->direction + 2) % 4) continue;
+        if (view->wraps) {
+            x = (x + view->width) % view->width;
+            y = (y + view->height) % view->height;
+        } else if (x < 0 || x >= view->width || y < 0 || y >= view->height) {
+            continue;
+        }
+        tile = view->cells[y * view->width + x];
+        if (tile == SNAKE_WALL || tile > 0) continue;
+        distance = abs(foodx - x) + abs(foody - y);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = d;
+        }
+    }
+    return best >= 0 ? keys[best] : SNAKE_STRAIGHT;
+}
@@ -0,0 +1,207 @@
+#include "policynet.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "game.h"
+
+// The eight directions the inputs look along, clockwise from up
+static const int rayx[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int rayy[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+void netFeatures(const Game& game, bool wraps, float* features) {
+    int longest = game.mapWidth > game.mapHeight ? game.mapWidth : game.mapHeight;
+    for (int r = 0; r < 8; ++r) {
+        float* out = features + r * 2;
+        out[0] = out[1] = 0;
+        int x = game.headxpos;
+        int y = game.headypos;
+        for (int distance = 1; distance <= longest; ++distance) {
+            x += rayx[r];
+            y += rayy[r];
+            if (wraps) {
+                x = (x + game.mapWidth) % game.mapWidth;
+                y = (y + game.mapHeight) % game.mapHeight;
+            } else if (x < 0 || x >= game.mapWidth || y < 0 || y >= game.mapHeight) {
+                out[0] = 1.0f / distance; // The edge kills like a wall
+                break;
+            }
+            int value = game.map[y * game.mapWidth + x];
+            if (value == WALL) {
+                out[0] = 1.0f / distance;
+                break;
+            }
+            if (value > 0 && out[1] == 0) out[1] = 1.0f / distance;
+        }
+    }
+
+    // Which way the food is, the short way round when the map wraps
+    float* food = features + 16;
+    food[0] = food[1] = food[2] = food[3] = 0;
+    int target = nearestFood(game, wraps);
+    if (target >= 0) {
+        int x = target % game.mapWidth - game.headxpos;
+        int y = target / game.mapWidth - game.headypos;
+        if (wraps) {
+            if (2 * x > game.mapWidth) x -= game.mapWidth;
+            if (2 * x < -game.mapWidth) x += game.mapWidth;
+            if (2 * y > game.mapHeight) y -= game.mapHeight;
+            if (2 * y < -game.mapHeight) y += game.mapHeight;
+        }
+        food[0] = y < 0;
+        food[1] = x > 0;
+        food[2] = y > 0;
+        food[3] = x < 0;
+    }
+
+    float* heading = features + 20;
+    for (int d = 0; d < 4; ++d) {
+        heading[d] = d == game.direction;
+    }
+}
+
+void netForwardScalar(const PolicyNet& net, const float* features, float* outputs, int count) {
+    for (int g = 0; g < count; ++g, features += NET_INPUTS, outputs += NET_OUTPUTS) {
+        float hidden[NET_HIDDEN];
+        memcpy(hidden, net.b1, sizeof(hidden));
+        for (int i = 0; i < NET_INPUTS; ++i) {
+            const float* row = net.w1 + i * NET_HIDDEN;
+            for (int h = 0; h < NET_HIDDEN; ++h) {
+                hidden[h] += features[i] * row[h];
+            }
+        }
+        for (int h = 0; h < NET_HIDDEN; ++h) {
+            if (hidden[h] < 0) hidden[h] = 0; // ReLU
+        }
+        for (int o = 0; o < NET_OUTPUTS; ++o) {
+            const float* row = net.w2 + o * NET_HIDDEN;
+            float sum = net.b2[o];
+            for (int h = 0; h < NET_HIDDEN; ++h) {
+                sum += hidden[h] * row[h];
+            }
+            outputs[o] = sum;
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// In policynet_avx2.cpp, built for AVX2 and FMA whatever the compiler flags
+void netForwardAvx2(const PolicyNet& net, const float* features, float* outputs, int count);
+
+// Whether the CPU can run it, asked once
+static bool haveAvx2() {
+    static const bool have = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return have;
+}
+#else
+static bool haveAvx2() { return false; }
+#endif
+
+void netForward(const PolicyNet& net, const float* features, float* outputs, int count) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (haveAvx2()) {
+        netForwardAvx2(net, features, outputs, count);
+        return;
+    }
+#endif
+    netForwardScalar(net, features, outputs, count);
+}
+
+const char* netKernel() {
+    return haveAvx2() ? "avx2" : "scalar";
+}
+
+int netChoice(const float* outputs, int direction) {
+    int best = direction;
+    for (int d = 0; d < NET_OUTPUTS; ++d) {
+        if (d == (direction + 2) % 4) continue; // Can't turn back on itself
+        if (outputs[d] > outputs[best]) best = d;
+    }
+    return best;
+}
+
+int netDirection(const PolicyNet& net, const Game& game, bool wraps) {
+    float features[NET_INPUTS];
+    float outputs[NET_OUTPUTS];
+    netFeatures(game, wraps, features);
+    netForward(net, features, outputs, 1);
+    return netChoice(outputs, game.direction);
+}
+
+bool saveNet(const char* path, const PolicyNet& net) {
+    NetHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKN", 4);
+    header.version = NET_VERSION;
+    header.inputs = NET_INPUTS;
+    header.hidden = NET_HIDDEN;
+    header.outputs = NET_OUTPUTS;
+
+    std::string temp = std::string(path) + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    std::string file(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.append(reinterpret_cast<const char*>(&net), sizeof(net));
+    bool ok = write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size()) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok && rename(temp.c_str(), path) == 0) return true;
+    unlink(temp.c_str());
+    return false;
+}
+
+NetFile::NetFile() : data(NULL), size(0) {
+}
+
+NetFile::~NetFile() {
+    close();
+}
+
+bool NetFile::open(const char* path, const char** error) {
+    close();
+    *error = "can't read it";
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        return false;
+    }
+    *error = "not a network";
+    if ((size_t)st.st_size != sizeof(NetHeader) + sizeof(PolicyNet)) {
+        ::close(fd);
+        return false;
+    }
+    size = st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        *error = "can't map it";
+        return false;
+    }
+    data = static_cast<const unsigned char*>(mapping);
+
+    const NetHeader* header = reinterpret_cast<const NetHeader*>(data);
+    if (memcmp(header->magic, "SNKN", 4) != 0 || header->version != NET_VERSION) {
+        close();
+        return false;
+    }
+    if (header->inputs != NET_INPUTS || header->hidden != NET_HIDDEN || header->outputs != NET_OUTPUTS) {
+        *error = "network of another shape";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void NetFile::close() {
+    if (data != NULL) {
+        munmap(const_cast<unsigned char*>(data), size);
+        data = NULL;
+        size = 0;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef POLICYNET_H
+#define POLICYNET_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct Game;
+
+// A small fixed-size neural network that plays the game: what the head
+// can see goes in, a score for each direction comes out and the highest
+// one the snake can take is played. Trained by ./evolve.
+//
+// Inputs: for each of the eight directions from the head (up, up-right,
+// right, ... clockwise), one over the distance to the nearest wall (or the
+// edge) and body cell that way, 0 for none; then whether the nearest food
+// is above, right of, below and left of the head; then the direction the
+// snake is going, as four 0s and 1s.
+const int NET_INPUTS = 24;
+const int NET_HIDDEN = 16;  // One hidden layer, ReLU
+const int NET_OUTPUTS = 4;  // Up, right, down, left, like Game::direction
+
+// Weights and biases, in the order they are stored in a .net file and
+// mutated in as a genome, laid out for the vector kernels: w1 by input
+// (w1[i * NET_HIDDEN + h] joins input i to hidden unit h), so the hidden
+// layer is a sum of rows of NET_HIDDEN, two AVX vectors each; w2 by output
+// (w2[o * NET_HIDDEN + h] joins hidden unit h to output o), so each output
+// is a dot product with the hidden layer.
+struct PolicyNet {
+    float w1[NET_INPUTS * NET_HIDDEN];
+    float b1[NET_HIDDEN];
+    float w2[NET_OUTPUTS * NET_HIDDEN];
+    float b2[NET_OUTPUTS];
+};
+
+const int NET_PARAMS = sizeof(PolicyNet) / sizeof(float);
+
+// .net file layout (native byte order): NetHeader, then the PolicyNet. The
+// header is 32 bytes, so in a mapping of the file every row of w1 starts
+// on a 32-byte boundary.
+struct NetHeader {
+    char magic[4];        // "SNKN"
+    uint32_t version;
+    uint32_t inputs;      // NET_INPUTS, NET_HIDDEN and NET_OUTPUTS it was made with
+    uint32_t hidden;
+    uint32_t outputs;
+    uint32_t reserved[3];
+};
+
+const uint32_t NET_VERSION = 2;
+
+// The inputs for the game as it stands
+void netFeatures(const Game& game, bool wraps, float* features);
+
+// Outputs for count sets of inputs, features[count][NET_INPUTS] in and
+// outputs[count][NET_OUTPUTS] out, with the AVX2 kernel if the CPU has
+// AVX2 and FMA and netForwardScalar() otherwise
+void netForward(const PolicyNet& net, const float* features, float* outputs, int count);
+
+// The same without vector instructions, one set at a time
+void netForwardScalar(const PolicyNet& net, const float* features, float* outputs, int count);
+
+// Name of the kernel netForward() uses, "avx2" or "scalar"
+const char* netKernel();
+
+// Direction (0-3) to take given the outputs, never straight back
+int netChoice(const float* outputs, int direction);
+
+// Direction (0-3) the network picks for the game
+int netDirection(const PolicyNet& net, const Game& game, bool wraps);
+
+// Write a network to path, replacing the file in one step. Returns false on error.
+bool saveNet(const char* path, const PolicyNet& net);
+
+// A .net file mapped into memory, its weights used in place
+class NetFile {
+public:
+    NetFile();
+    ~NetFile();
+
+    // Map the file. Returns false if it can't be read or doesn't hold a
+    // network of this shape; error then says why.
+    bool open(const char* path, const char** error);
+    void close();
+
+    const PolicyNet& net() const { return *reinterpret_cast<const PolicyNet*>(data + sizeof(NetHeader)); }
+
+private:
+    const unsigned char* data;
+    size_t size;
+};
+
+#endif
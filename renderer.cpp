@@ -0,0 +1,111 @@
+#include "renderer.h"
+
+#include <cstring>
+#include <ctime>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "timing.h"
+
+// Head in bright green, the body fading to dark green at the tail, food in
+// red (yellow when worth more) and walls in grey
+static const ColourStyle palette[COLOUR_COUNT] = {
+    {0, -1, -1},    // Plain
+    {1, 10, 118},   // Head
+    {0, 10, 46},    // Body, nearest the head
+    {0, 2, 40},
+    {0, 2, 34},
+    {2, 2, 28},     // Body, nearest the tail
+    {1, 9, 196},    // Food
+    {1, 11, 226},   // Food worth more
+    {0, 8, 244},    // Wall
+};
+
+const ColourStyle& colourStyle(int colour) {
+    return palette[colour];
+}
+
+Renderer::Renderer()
+    : adaptive(true), colour(false), skipEvery(1), sinceDrawn(0), drawnScore(-1), catchUpNanos(CATCH_UP_NANOS) {
+    memset(&stats, 0, sizeof(stats));
+    drawnAt = monotonicNow();
+    skipChangedAt = drawnAt;
+}
+
+// Bytes written to the terminal that it hasn't taken yet (0 if unknown)
+static long pendingOutput() {
+    int pending = 0;
+    if (ioctl(STDOUT_FILENO, TIOCOUTQ, &pending) < 0) return 0;
+    return pending;
+}
+
+static long nanosBetween(const struct timespec& from, const struct timespec& to) {
+    return (to.tv_sec - from.tv_sec) * 1000000000L + (to.tv_nsec - from.tv_nsec);
+}
+
+void Renderer::draw(const int* cells, int width, int height, char (*glyphOf)(int), int score, int length) {
+    struct timespec now = monotonicNow();
+    if (adaptive && score == drawnScore && nanosBetween(drawnAt, now) < MAX_STALE_NANOS) {
+        // Skip while thinning out, or while the last frame is still queued
+        if (sinceDrawn + 1 < skipEvery || pendingOutput() > PENDING_OUTPUT_LIMIT) {
+            sinceDrawn++;
+            stats.skipped++;
+            return;
+        }
+    }
+
+    // Read the byte counter outside the timed window so it isn't billed as drawing
+    long bytesBefore = outputCounter();
+    long cpuBefore = threadCpuNanos();
+    drawFrame(cells, width, height, glyphOf, score, length);
+    stats.cpuNanos += threadCpuNanos() - cpuBefore;
+    drawnAt = monotonicNow();
+    stats.bytes += outputCounter() - bytesBefore;
+    stats.frames++;
+    if (sinceDrawn > 0) stats.coalesced++;
+    sinceDrawn = 0;
+    drawnScore = score;
+
+    // A write that blocked or left output queued means the terminal is behind
+    long took = nanosBetween(now, drawnAt);
+    if (took > stats.slowest) stats.slowest = took;
+    long pending = pendingOutput();
+    if (took > SLOW_FRAME_NANOS || pending > PENDING_OUTPUT_LIMIT) {
+        if (skipEvery < MAX_FRAME_SKIP) skipEvery *= 2;
+        skipChangedAt = drawnAt;
+        // A write only blocks once the terminal's buffer is full, and how
+        // long it blocked hints at how much is queued ahead of it
+        catchUpNanos = took * 4 > CATCH_UP_NANOS ? took * 4 : CATCH_UP_NANOS;
+    } else if (skipEvery > 1 && pending < PENDING_OUTPUT_LIMIT / 4 &&
+               nanosBetween(skipChangedAt, drawnAt) > catchUpNanos) {
+        skipEvery /= 2;
+        skipChangedAt = drawnAt;
+    }
+}
+
+void Renderer::printStats(FILE* out) const {
+    if (stats.frames == 0) return;
+    fprintf(out, "Renderer %s: %ld frames, %.1f bytes/frame, %.1f us CPU/frame, %.1f ms slowest\n",
+            name(), stats.frames, (double)stats.bytes / stats.frames,
+            stats.cpuNanos / 1000.0 / stats.frames, stats.slowest / 1e6);
+    if (stats.skipped > 0) {
+        fprintf(out, "Renderer %s: %ld frames skipped for a slow terminal, folded into %ld later frames\n",
+                name(), stats.skipped, stats.coalesced);
+    }
+}
+
+const unsigned char* Renderer::colourTable(int length) {
+    const int lowest = FOOD_VALUE_BASE - MAX_FOOD_VALUE;
+    tileColours.resize(length + 1 - lowest);
+    for (int value = lowest; value <= length; ++value) {
+        tileColours[value - lowest] = getMapColour(value, length, stats.frames);
+    }
+    return &tileColours[-lowest];
+}
+
+Renderer* createRenderer(const char* name) {
+    if (strcmp(name, "curses") == 0) return new CursesRenderer();
+    if (strcmp(name, "ansi") == 0) return new AnsiRenderer();
+    if (strcmp(name, "halfblock") == 0) return new HalfBlockRenderer();
+    return NULL;
+}
@@ -0,0 +1,198 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ansiframe.h"
+#include "game.h"
+
+// Per-renderer counters so backends can be compared
+struct RenderStats {
+    long frames;    // Frames drawn
+    long bytes;     // Bytes sent to the terminal while drawing them
+    long cpuNanos;  // Thread CPU time spent drawing them
+    long skipped;   // Frames not drawn because the terminal was behind
+    long coalesced; // Drawn frames that also carried skipped ones
+    long slowest;   // Most nanoseconds one frame took to get out
+};
+
+// Backpressure: output still queued for the terminal, or a frame that
+// took this long to write, means the terminal (or the link to it) is behind
+const long PENDING_OUTPUT_LIMIT = 4096;
+const long SLOW_FRAME_NANOS = 15000000L;
+const int MAX_FRAME_SKIP = 16;            // Draw at least every 16th frame
+const long CATCH_UP_NANOS = 1000000000L; // Least time without backpressure before drawing twice as often
+const long MAX_STALE_NANOS = 250000000L;  // and at least four times a second
+
+// What a tile colour (COLOUR_* in game.h) looks like on the terminal
+struct ColourStyle {
+    int intensity;  // 0 normal, 1 bold, 2 dim
+    int colour16;   // Foreground on a 16-colour terminal (-1 = default)
+    int colour256;  // Foreground on a 256-colour terminal (-1 = default)
+};
+
+// Look of each tile colour, shared by the backends
+const ColourStyle& colourStyle(int colour);
+
+// Draws the board on the terminal and reads keys from it
+class Renderer {
+public:
+    Renderer();
+    virtual ~Renderer() {}
+
+    virtual const char* name() const = 0;
+
+    // Take over the terminal. Returns false if it can't be used.
+    virtual bool init() = 0;
+
+    // Give the terminal back the way it was found
+    virtual void shutdown() = 0;
+
+    // Next pressed key, or -1 (curses' ERR) if none is waiting
+    virtual int readKey() = 0;
+
+    // Replace the screen with a line of text, such as the final score
+    virtual void showMessage(const char* text) = 0;
+
+    // Write a line of text on a row of the screen, such as below the board
+    virtual void drawStatus(int row, const char* text) = 0;
+
+    // Screen row just below a board of the given height, for drawStatus()
+    virtual int statusRow(int height) const { return height + 1; }
+
+    // Draw the score line and the board below it, and account for the cost in stats.
+    // length is the snake's length, which getMapColour() needs to find the head.
+    // While the terminal is behind only every Nth frame is drawn (N doubles
+    // while it stays behind and halves as it catches up); a frame where the
+    // score changed is always drawn.
+    void draw(const int* cells, int width, int height, char (*glyphOf)(int), int score, int length);
+
+    // Print the collected statistics
+    void printStats(FILE* out) const;
+
+    RenderStats stats;
+    bool adaptive;  // Skip frames under backpressure (on by default)
+    bool colour;    // Draw tiles in their getMapColour() colours (off by default)
+
+protected:
+    virtual void drawFrame(const int* cells, int width, int height, char (*glyphOf)(int), int score, int length) = 0;
+
+    // Running total of bytes this backend has written to the terminal
+    virtual long outputCounter() = 0;
+
+    // The board was wiped off the screen; draw the next frame whatever happens
+    void boardLost() { drawnScore = -1; }
+
+    // getMapColour() for every tile value this frame can hold, worked out
+    // once per frame: the result r gives tile v's colour as r[v]
+    const unsigned char* colourTable(int length);
+
+private:
+    int skipEvery;          // Draw one frame in this many (1 = all of them)
+    int sinceDrawn;         // Frames skipped since the last one drawn
+    int drawnScore;         // Score in the last frame drawn
+    struct timespec drawnAt; // When the last frame was drawn
+    std::vector<unsigned char> tileColours; // Reused by colourTable()
+    struct timespec skipChangedAt; // When N last went up or down
+    long catchUpNanos;      // How long N stays up after the terminal fell behind
+};
+
+// The original ncurses backend: clear(), one mvaddch() per cell, refresh()
+class CursesRenderer : public Renderer {
+public:
+    const char* name() const { return "curses"; }
+    bool init();
+    void shutdown();
+    int readKey();
+    void showMessage(const char* text);
+    void drawStatus(int row, const char* text);
+
+protected:
+    void drawFrame(const int* cells, int width, int height, char (*glyphOf)(int), int score, int length);
+    long outputCounter();
+
+private:
+    int colourAttrs[COLOUR_COUNT]; // Colour pair and intensity for each tile colour
+};
+
+// Talks to the terminal directly: raw mode, frames encoded as diffs with
+// minimal cursor movement and sent with a single write()
+class AnsiRenderer : public Renderer {
+public:
+    // Output goes to fd, the terminal unless a benchmark points it elsewhere
+    explicit AnsiRenderer(int fd = 1);
+    const char* name() const { return "ansi"; }
+    bool init();
+    void shutdown();
+    int readKey();
+    void showMessage(const char* text);
+    void drawStatus(int row, const char* text);
+
+protected:
+    // How a terminal cell looks: intensity (0 normal, 1 bold, 2 dim) and
+    // terminal colour numbers (-1 = the terminal's default)
+    struct TextStyle {
+        int intensity;
+        int fg;
+        int bg;
+    };
+
+    // Shortest SGR sequence that turns style a into style b ("" if none is needed)
+    static std::string sgrTransition(const TextStyle& a, const TextStyle& b, bool has256);
+    static bool terminalHas256Colours();
+
+    void drawFrame(const int* cells, int width, int height, char (*glyphOf)(int), int score, int length);
+    long outputCounter() { return bytesOut; }
+
+    // Set the size of the grid of terminal cells below the score line
+    void resizeGrid(int w, int h);
+
+    // Give frame its SGR sequences, one per pair of values in colours
+    virtual void buildPalette();
+
+    // Send glyphs (and colours, if not NULL) as a diff, with the score line if it changed
+    void sendFrame(const unsigned char* cellColours, int score);
+
+    int width;          // Grid size in terminal cells
+    int height;
+    AnsiFrame frame;
+    std::string glyphs; // Reused glyph buffer, one per terminal cell
+    std::vector<unsigned char> colours; // Reused colour buffer
+    bool havePalette;   // Whether frame has the SGR sequences for the colours
+
+private:
+    void writeAll(const char* data, size_t size);
+
+    bool active;
+    int outputFd;       // Where frames go
+    long bytesOut;
+    int lastScore;      // Score on screen (-1 = not drawn)
+    std::string packet; // Reused buffer for the score line plus the board
+};
+
+// Packs two board rows into each terminal row with the half-block glyphs
+// (upper, lower and full block in the tiles' colours), so twice as much
+// board fits on the screen. Always in colour: the glyphs only show which
+// half of a cell is filled.
+class HalfBlockRenderer : public AnsiRenderer {
+public:
+    explicit HalfBlockRenderer(int fd = 1);
+    const char* name() const { return "halfblock"; }
+    int statusRow(int height) const { return (height + 1) / 2 + 1; }
+
+protected:
+    void drawFrame(const int* cells, int width, int height, char (*glyphOf)(int), int score, int length);
+    void buildPalette();
+
+private:
+    // Glyph and style of a terminal cell for each (top, bottom) pair of tile colours
+    char pairGlyph[COLOUR_COUNT * COLOUR_COUNT];
+    unsigned char pairStyle[COLOUR_COUNT * COLOUR_COUNT];
+};
+
+// Create a renderer by name ("curses", "ansi" or "halfblock"). Returns NULL if unknown.
+Renderer* createRenderer(const char* name);
+
+#endif
@@ -0,0 +1,237 @@
+#include "replay.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "game.h"
+
+static const uint32_t REPLAY_VERSION = 3;
+
+ReplayWriter::ReplayWriter()
+    : file(NULL), offset(0), ticks(0), interval(1), cellCount(0) {
+}
+
+ReplayWriter::~ReplayWriter() {
+    close();
+}
+
+bool ReplayWriter::open(const char* path, int width, int height, int keyframeInterval, uint32_t rules, uint64_t seed,
+                        int foodItems, const std::vector<int>& foodValues) {
+    close();
+    file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    ReplayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKR", 4);
+    header.version = REPLAY_VERSION;
+    header.width = width;
+    header.height = height;
+    header.keyframeInterval = keyframeInterval;
+    header.rules = rules;
+    header.seed = seed;
+    header.foodItems = foodItems;
+    header.foodValueCount = foodValues.size() < (size_t)REPLAY_FOOD_VALUES ? foodValues.size() : REPLAY_FOOD_VALUES;
+    for (uint32_t i = 0; i < header.foodValueCount; ++i) {
+        header.foodValues[i] = foodValues[i];
+    }
+    fwrite(&header, sizeof(header), 1, file);
+
+    offset = sizeof(header);
+    ticks = 0;
+    interval = keyframeInterval;
+    cellCount = width * height;
+    index.clear();
+    return true;
+}
+
+void ReplayWriter::keyframe(const ReplayState& state) {
+    if (file == NULL) return;
+    index.push_back(offset);
+    fwrite(&state.keyframe, sizeof(state.keyframe), 1, file);
+    fwrite(&state.cells[0], sizeof(int32_t), cellCount, file);
+    offset += sizeof(state.keyframe) + sizeof(int32_t) * cellCount;
+}
+
+void ReplayWriter::input(int direction) {
+    if (file == NULL) return;
+    fputc(direction, file);
+    ++offset;
+    ++ticks;
+}
+
+bool ReplayWriter::close() {
+    if (file == NULL) return true;
+
+    ReplayFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.indexOffset = offset;
+    footer.totalTicks = ticks;
+    footer.keyframeCount = index.size();
+    memcpy(footer.magic, "SNKINDEX", 8);
+    if (!index.empty()) fwrite(&index[0], sizeof(uint64_t), index.size(), file);
+    fwrite(&footer, sizeof(footer), 1, file);
+
+    bool ok = ferror(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    file = NULL;
+    return ok;
+}
+
+// Whether a keyframe holds a state the engine could have been in, checked
+// like a saved game so a damaged one is never restored
+static bool validKeyframe(const unsigned char* p, int width, int height) {
+    ReplayKeyframe k;
+    memcpy(&k, p, sizeof(k));
+    int cellCount = width * height;
+    if (k.food < 1 || k.food > cellCount || k.direction < 0 || k.direction > 3 ||
+        k.difficulty < 1 || k.difficulty > 9 || k.forgivenessCount < 0 ||
+        k.headx < 0 || k.headx >= width || k.heady < 0 || k.heady >= height) {
+        return false;
+    }
+    // No two body cells may share a lifetime, or the tail can't be followed
+    std::vector<char> lifetimeSeen(k.food + 1, 0);
+    const unsigned char* cells = p + sizeof(ReplayKeyframe);
+    for (int i = 0; i < cellCount; ++i) {
+        int32_t value;
+        memcpy(&value, cells + i * sizeof(int32_t), sizeof(value));
+        if (!validCell(value, k.food)) return false;
+        if (value > 0) {
+            if (lifetimeSeen[value]) return false;
+            lifetimeSeen[value] = 1;
+        }
+    }
+    int32_t head;
+    memcpy(&head, cells + (k.heady * width + k.headx) * sizeof(int32_t), sizeof(head));
+    return head == k.food;
+}
+
+ReplayReader::ReplayReader()
+    : data(NULL), size(0), header(NULL), ticks(0), keyframes(0), keyframeSize(0) {
+}
+
+ReplayReader::~ReplayReader() {
+    close();
+}
+
+bool ReplayReader::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ReplayHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size = st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+    data = static_cast<const unsigned char*>(mapping);
+
+    header = reinterpret_cast<const ReplayHeader*>(data);
+    if (memcmp(header->magic, "SNKR", 4) != 0 || header->version != REPLAY_VERSION ||
+        header->keyframeInterval == 0 || header->width == 0 || header->height == 0 ||
+        header->width > 4096 || header->height > 4096 || header->foodItems < 1 ||
+        header->foodValueCount > (uint32_t)REPLAY_FOOD_VALUES) {
+        close();
+        return false;
+    }
+    for (uint32_t i = 0; i < header->foodValueCount; ++i) {
+        if (header->foodValues[i] < 1 || header->foodValues[i] > 9) {
+            close();
+            return false;
+        }
+    }
+    keyframeSize = sizeof(ReplayKeyframe) + sizeof(int32_t) * header->width * header->height;
+    size_t blockSize = keyframeSize + header->keyframeInterval;
+
+    // Use the index if the file was closed properly
+    size_t blocksEnd = size; // Where the keyframes and inputs stop
+    ReplayFooter footer;
+    if (size >= sizeof(ReplayHeader) + sizeof(footer)) {
+        memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+        // Compared piece by piece, so no sum can wrap round
+        size_t indexEnd = size - sizeof(footer);
+        if (memcmp(footer.magic, "SNKINDEX", 8) == 0 && footer.indexOffset <= indexEnd &&
+            footer.keyframeCount <= (indexEnd - footer.indexOffset) / sizeof(uint64_t) &&
+            footer.indexOffset + footer.keyframeCount * sizeof(uint64_t) == indexEnd) {
+            index.resize(footer.keyframeCount);
+            if (!index.empty()) {
+                memcpy(&index[0], data + footer.indexOffset, index.size() * sizeof(uint64_t));
+            }
+            keyframes = footer.keyframeCount;
+            ticks = footer.totalTicks;
+            blocksEnd = footer.indexOffset;
+        }
+    }
+
+    // Otherwise the game was cut short: walk the fixed-size blocks instead
+    if (index.empty()) {
+        size_t payload = size - sizeof(ReplayHeader);
+        size_t fullBlocks = payload / blockSize;
+        size_t rest = payload % blockSize;
+        for (size_t k = 0; k < fullBlocks; ++k) {
+            index.push_back(sizeof(ReplayHeader) + k * blockSize);
+        }
+        ticks = fullBlocks * header->keyframeInterval;
+        if (rest >= keyframeSize) {
+            index.push_back(sizeof(ReplayHeader) + fullBlocks * blockSize);
+            ticks += rest - keyframeSize;
+        }
+        keyframes = index.size();
+    }
+
+    // Every keyframe must lie inside the file, and the ticks can't go past
+    // the input bytes there are, whatever the footer says
+    long inputs = 0;
+    bool gap = false;
+    for (long k = 0; k < keyframes; ++k) {
+        if (index[k] < sizeof(ReplayHeader) || index[k] > blocksEnd || blocksEnd - index[k] < keyframeSize ||
+            !validKeyframe(data + index[k], header->width, header->height)) {
+            close();
+            return false;
+        }
+        size_t available = blocksEnd - index[k] - keyframeSize;
+        if (!gap) {
+            inputs = k * header->keyframeInterval + (available < header->keyframeInterval ? available : header->keyframeInterval);
+            gap = available < header->keyframeInterval;
+        }
+    }
+    if (ticks < 0 || ticks > inputs) ticks = inputs;
+
+    if (keyframes == 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ReplayReader::close() {
+    if (data != NULL) munmap(const_cast<unsigned char*>(data), size);
+    data = NULL;
+    header = NULL;
+    size = 0;
+    index.clear();
+    ticks = 0;
+    keyframes = 0;
+}
+
+void ReplayReader::keyframeBefore(long tick, ReplayState& state) const {
+    long k = tick / header->keyframeInterval;
+    if (k < 0) k = 0;
+    if (k >= keyframes) k = keyframes - 1;
+    const unsigned char* p = data + index[k];
+    memcpy(&state.keyframe, p, sizeof(ReplayKeyframe));
+    state.cells.resize(header->width * header->height);
+    memcpy(&state.cells[0], p + sizeof(ReplayKeyframe), state.cells.size() * sizeof(int32_t));
+}
+
+int ReplayReader::inputAt(long tick) const {
+    long k = tick / header->keyframeInterval;
+    return data[index[k] + keyframeSize + tick % header->keyframeInterval];
+}
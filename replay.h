@@ -0,0 +1,128 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Replay file layout (native byte order):
+//
+//   ReplayHeader
+//   block 0: ReplayKeyframe + cells, then up to keyframeInterval input bytes
+//   block 1: ...
+//   index: one uint64_t file offset per keyframe
+//   ReplayFooter
+//
+// Keyframe k holds the full game state after k * keyframeInterval ticks.
+// Input byte t is the direction the snake moved on tick t + 1.
+// Blocks have a fixed size, so a file cut short without its index can
+// still be read.
+
+// Most --food-values a replay can record
+const int REPLAY_FOOD_VALUES = 32;
+
+struct ReplayHeader {
+    char magic[4];            // "SNKR"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t keyframeInterval;
+    uint32_t rules;           // Rule set the game was played with
+    uint64_t seed;
+    uint32_t foodItems;       // Pieces of food on the map at once
+    uint32_t foodValueCount;  // Entries used in foodValues; 0 = always 1
+    uint8_t foodValues[REPLAY_FOOD_VALUES]; // --food-values, in order
+};
+
+// Everything needed to resume a game at a tick, minus the board cells
+struct ReplayKeyframe {
+    uint64_t tick;
+    uint64_t rngState;
+    int32_t headx;
+    int32_t heady;
+    int32_t direction;
+    int32_t food;
+    int32_t score;
+    int32_t forgiving;        // Snake is waiting out a collision
+    int32_t forgivenessCount;
+    int32_t difficulty;
+};
+
+struct ReplayFooter {
+    uint64_t indexOffset;
+    uint64_t totalTicks;
+    uint64_t keyframeCount;
+    char magic[8];            // "SNKINDEX"
+};
+
+// Full game state used when writing or seeking
+struct ReplayState {
+    ReplayKeyframe keyframe;
+    std::vector<int32_t> cells;
+};
+
+// Records a game as it is played
+class ReplayWriter {
+public:
+    ReplayWriter();
+    ~ReplayWriter();
+
+    bool open(const char* path, int width, int height, int keyframeInterval, uint32_t rules, uint64_t seed,
+              int foodItems, const std::vector<int>& foodValues);
+    bool isOpen() const { return file != NULL; }
+
+    // Whether the next call should be keyframe() rather than input()
+    bool wantsKeyframe() const { return ticks % interval == 0; }
+
+    void keyframe(const ReplayState& state);
+    void input(int direction);
+
+    // Write the index and footer
+    bool close();
+
+private:
+    FILE* file;
+    uint64_t offset;
+    uint64_t ticks;
+    int interval;
+    int cellCount;
+    std::vector<uint64_t> index;
+};
+
+// Reads a replay in place from a memory mapping
+class ReplayReader {
+public:
+    ReplayReader();
+    ~ReplayReader();
+
+    bool open(const char* path);
+    void close();
+
+    int width() const { return header->width; }
+    int height() const { return header->height; }
+    int keyframeInterval() const { return header->keyframeInterval; }
+    uint32_t rules() const { return header->rules; }
+    int foodItems() const { return header->foodItems; }
+    std::vector<int> foodValues() const {
+        return std::vector<int>(header->foodValues, header->foodValues + header->foodValueCount);
+    }
+    long totalTicks() const { return ticks; }
+    long keyframeCount() const { return keyframes; }
+
+    // Load the last keyframe at or before tick
+    void keyframeBefore(long tick, ReplayState& state) const;
+
+    // Direction the snake moved on tick + 1
+    int inputAt(long tick) const;
+
+private:
+    const unsigned char* data;
+    size_t size;
+    const ReplayHeader* header;
+    std::vector<uint64_t> index;     // File offset of each keyframe
+    long ticks;
+    long keyframes;
+    size_t keyframeSize;             // ReplayKeyframe plus cells
+};
+
+#endif
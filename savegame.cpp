@@ -0,0 +1,242 @@
+#include "savegame.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "game.h"
+#include "replay.h"
+
+// FNV-1a, continuing from hash
+static uint32_t checksum(const unsigned char* data, size_t size, uint32_t hash) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t checksumOf(const SaveHeader& header, const unsigned char* runs) {
+    SaveHeader copy = header;
+    copy.checksum = 0;
+    uint32_t hash = checksum(reinterpret_cast<const unsigned char*>(&copy), sizeof(copy), 2166136261u);
+    return checksum(runs, header.runBytes, hash);
+}
+
+static void putVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static bool getVarint(const unsigned char*& p, const unsigned char* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        unsigned char byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) return true;
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+bool saveGame(const char* path, const Game& game, uint32_t rules) {
+    // Runs of equal values, or of values going up or down by one
+    std::string runs;
+    for (int i = 0; i < game.mapSize; ) {
+        int first = game.map[i];
+        int step = i + 1 < game.mapSize ? game.map[i + 1] - first : 0;
+        if (step < -1 || step > 1) step = 0;
+        int count = 1;
+        while (i + count < game.mapSize && game.map[i + count] == first + step * count) {
+            ++count;
+        }
+        if (count == 1) step = 0;
+        putVarint(runs, static_cast<uint32_t>(count) << 2 | (step == 0 ? 0 : step == 1 ? 1 : 2));
+        putVarint(runs, zigzag(first));
+        i += count;
+    }
+
+    SaveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SNKS", 4);
+    header.version = SAVE_VERSION;
+    header.width = game.mapWidth;
+    header.height = game.mapHeight;
+    header.rules = rules;
+    header.runBytes = runs.size();
+    header.rngState = game.rngState;
+    header.headx = game.headxpos;
+    header.heady = game.headypos;
+    header.direction = game.direction;
+    header.food = game.food;
+    header.score = game.score;
+    header.difficulty = game.difficulty;
+    header.wallsEnabled = game.wallsEnabled;
+    header.forgiving = game.isInForgivenessState;
+    header.forgivenessCount = game.forgivenessCount;
+    header.checksum = checksumOf(header, reinterpret_cast<const unsigned char*>(runs.data()));
+
+    // Write a new file and rename it over the old one, so a crash leaves
+    // either the old save or the new one
+    std::string temp = std::string(path) + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    std::string file(reinterpret_cast<const char*>(&header), sizeof(header));
+    file += runs;
+    bool ok = write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size()) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path) < 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadGame(const char* path, Game& game, uint32_t rules, const char** error) {
+    *error = "not a saved game";
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *error = strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SaveHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        *error = strerror(errno);
+        return false;
+    }
+    const unsigned char* data = static_cast<const unsigned char*>(mapping);
+
+    // Check the header, then decode the cells into a keyframe to restore
+    SaveHeader header;
+    memcpy(&header, data, sizeof(header));
+    const unsigned char* runs = data + sizeof(header);
+    bool ok = memcmp(header.magic, "SNKS", 4) == 0 && header.version == SAVE_VERSION;
+    if (ok && !(header.width >= 3 && header.width <= 4096 && header.height >= 3 && header.height <= 4096 &&
+                header.runBytes == size - sizeof(header) && header.checksum == checksumOf(header, runs))) {
+        *error = "damaged saved game";
+        ok = false;
+    }
+    if (ok && header.rules != FIXTURE_RULES && header.rules != rules) {
+        *error = "saved with other rules";
+        ok = false;
+    }
+    if (ok && (header.food < 1 || header.food > (int32_t)(header.width * header.height) || header.direction < 0 || header.direction > 3 ||
+               header.difficulty < 1 || header.difficulty > 9 ||
+               header.headx < 0 || header.headx >= (int32_t)header.width ||
+               header.heady < 0 || header.heady >= (int32_t)header.height)) {
+        *error = "damaged saved game";
+        ok = false;
+    }
+
+    ReplayState state;
+    int cellCount = header.width * header.height;
+    if (ok) {
+        state.cells.resize(cellCount);
+        // No two body cells may share a lifetime, or the tail can't be followed
+        std::vector<char> lifetimeSeen(header.food + 1, 0);
+        const unsigned char* p = runs;
+        const unsigned char* end = runs + header.runBytes;
+        int cell = 0;
+        while (ok && p < end) {
+            uint32_t countAndStep, first;
+            ok = getVarint(p, end, countAndStep) && getVarint(p, end, first);
+            int count = countAndStep >> 2;
+            int step = (countAndStep & 3) == 0 ? 0 : (countAndStep & 3) == 1 ? 1 : -1;
+            int32_t value = unzigzag(first);
+            ok = ok && (countAndStep & 3) != 3 && count > 0 && count <= cellCount - cell;
+            for (int i = 0; ok && i < count; ++i) {
+                int32_t cellValue = value + step * i;
+                ok = validCell(cellValue, header.food);
+                if (ok && cellValue > 0) {
+                    ok = !lifetimeSeen[cellValue];
+                    lifetimeSeen[cellValue] = 1;
+                }
+                state.cells[cell++] = cellValue;
+            }
+        }
+        ok = ok && cell == cellCount &&
+             state.cells[header.heady * header.width + header.headx] == header.food;
+        if (!ok) *error = "damaged saved game";
+    }
+    munmap(mapping, size);
+    if (!ok) return false;
+
+    if (!game.hasLevel() || game.mapWidth != (int)header.width || game.mapHeight != (int)header.height) {
+        game.resize(header.width, header.height);
+    }
+    ReplayKeyframe& k = state.keyframe;
+    memset(&k, 0, sizeof(k));
+    k.rngState = header.rngState;
+    k.headx = header.headx;
+    k.heady = header.heady;
+    k.direction = header.direction;
+    k.food = header.food;
+    k.score = header.score;
+    k.forgiving = header.forgiving;
+    k.forgivenessCount = header.forgivenessCount;
+    k.difficulty = header.difficulty;
+    game.restoreState(state);
+    game.wallsEnabled = header.wallsEnabled != 0;
+    return true;
+}
+
+bool coilSnake(Game& game, int length) {
+    // Every open cell, row by row from the bottom, turning at the ends
+    std::vector<int> path;
+    for (int y = game.mapHeight - 1; y >= 0; --y) {
+        int row = game.mapHeight - 1 - y;
+        for (int i = 0; i < game.mapWidth; ++i) {
+            int x = row % 2 == 0 ? i : game.mapWidth - 1 - i;
+            int cell = y * game.mapWidth + x;
+            if (game.map[cell] == WALL) continue;
+            game.map[cell] = EMPTY;
+            path.push_back(cell);
+        }
+    }
+    // One more cell than the snake, for the head to move into
+    if (length < 2 || length >= (int)path.size()) return false;
+
+    // Tail first; each cell stays occupied one tick longer than the one before
+    for (int i = 0; i < length; ++i) {
+        if (i > 0) {
+            int dx = path[i] % game.mapWidth - path[i - 1] % game.mapWidth;
+            int dy = path[i] / game.mapWidth - path[i - 1] / game.mapWidth;
+            if (dx * dx + dy * dy != 1) return false; // Walls in the way of the coil
+        }
+        game.map[path[i]] = i + 1;
+    }
+    int head = path[length - 1];
+    int next = path[length];
+    game.headxpos = head % game.mapWidth;
+    game.headypos = head / game.mapWidth;
+    game.food = length;
+    int dx = next % game.mapWidth - game.headxpos;
+    int dy = next / game.mapWidth - game.headypos;
+    game.direction = dy < 0 ? 0 : dx > 0 ? 1 : dy > 0 ? 2 : 3;
+    game.rehash();
+    game.placeFood();
+    return true;
+}
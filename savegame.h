@@ -0,0 +1,57 @@
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+
+#include <cstdint>
+
+struct Game;
+
+// Saved game layout (native byte order):
+//
+//   SaveHeader
+//   runs: cells in order, as many as cover width * height, each
+//     varint  count << 2 | step    step 0: all the same, 1: each one more, 2: each one less
+//     varint  first value, zigzag encoded
+//
+// Empty cells and walls come in long runs, and so does the body where it
+// lies straight along a row, since its cells count down by one from the
+// head. A 40x20 board with a 700-long coiled snake takes under 200 bytes.
+
+struct SaveHeader {
+    char magic[4];            // "SNKS"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rules;           // Rule set the game was played with, or FIXTURE_RULES
+    uint32_t runBytes;        // Size of the runs that follow
+    uint64_t rngState;
+    int32_t headx;
+    int32_t heady;
+    int32_t direction;
+    int32_t food;             // Snake length
+    int32_t score;
+    int32_t difficulty;
+    int32_t wallsEnabled;
+    int32_t forgiving;        // Snake is waiting out a collision
+    int32_t forgivenessCount;
+    uint32_t checksum;        // FNV-1a of the header (with this field 0) and the runs
+};
+
+const uint32_t SAVE_VERSION = 1;
+
+// Rules of a fixture, which loads under any rules (0 is snake2's rule set)
+const uint32_t FIXTURE_RULES = 0xffffffff;
+
+// Save the game to path, replacing the file in one step. Returns false on error.
+bool saveGame(const char* path, const Game& game, uint32_t rules);
+
+// Load a game saved under the same rules (or a fixture), resizing game to fit unless it
+// already has a level of the right size. Returns false if the file can't
+// be read or fails validation; error then says why.
+bool loadGame(const char* path, Game& game, uint32_t rules, const char** error);
+
+// Put a snake of the given length on the empty board, coiled row by row
+// from the bottom left, and food in front of it. For benchmark fixtures.
+// Returns false if it doesn't fit.
+bool coilSnake(Game& game, int length);
+
+#endif
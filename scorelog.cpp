@@ -0,0 +1,229 @@
+#include "scorelog.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Checksum of a record's fields, a word at a time (FNV-1a over 32-bit words)
+static uint32_t scoreChecksum(const ScoreRecord& record) {
+    const size_t start = offsetof(ScoreRecord, score);
+    uint32_t words[(sizeof(ScoreRecord) - start) / 4];
+    memcpy(words, reinterpret_cast<const char*>(&record) + start, sizeof(words));
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(words) / 4; ++i) {
+        hash = (hash ^ words[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void sealScoreRecord(ScoreRecord& record) {
+    memcpy(record.magic, "SKS1", 4);
+    record.checksum = scoreChecksum(record);
+}
+
+// Min-heap on score, so the worst of the best is on top
+static bool betterScore(const ScoreRecord& a, const ScoreRecord& b) {
+    return a.score > b.score;
+}
+
+ScoreBoard::ScoreBoard() {
+    for (int b = 0; b < BUCKETS; ++b) {
+        heaps[b].reserve(SCORE_TOP_K);
+    }
+}
+
+int ScoreBoard::bucketOf(int difficulty, bool walls) {
+    if (difficulty < 1) difficulty = 1;
+    if (difficulty > 9) difficulty = 9;
+    return (difficulty - 1) * 2 + (walls ? 1 : 0);
+}
+
+void ScoreBoard::add(const ScoreRecord& record) {
+    std::vector<ScoreRecord>& heap = heaps[bucketOf(record.difficulty, record.walls != 0)];
+    if ((int)heap.size() < SCORE_TOP_K) {
+        heap.push_back(record);
+        std::push_heap(heap.begin(), heap.end(), betterScore);
+    } else if (record.score > heap.front().score) {
+        std::pop_heap(heap.begin(), heap.end(), betterScore);
+        heap.back() = record;
+        std::push_heap(heap.begin(), heap.end(), betterScore);
+    }
+}
+
+void ScoreBoard::top(int difficulty, bool walls, std::vector<ScoreRecord>& out) const {
+    out = heaps[bucketOf(difficulty, walls)];
+    std::sort(out.begin(), out.end(), betterScore);
+}
+
+void ScoreBoard::all(std::vector<ScoreRecord>& out) const {
+    out.clear();
+    for (int b = 0; b < BUCKETS; ++b) {
+        out.insert(out.end(), heaps[b].begin(), heaps[b].end());
+    }
+}
+
+// Add every intact record in a mapped log to a board. Damaged bytes are
+// skipped until the next record marker.
+static void scanLog(const unsigned char* data, size_t size, ScoreBoard& board, long& records, long& damaged) {
+    size_t offset = 0;
+    while (offset + sizeof(ScoreRecord) <= size) {
+        ScoreRecord record;
+        memcpy(&record, data + offset, sizeof(record));
+        if (memcmp(record.magic, "SKS1", 4) == 0 && record.checksum == scoreChecksum(record)) {
+            board.add(record);
+            ++records;
+            offset += sizeof(record);
+            continue;
+        }
+        const void* next = memchr(data + offset + 1, 'S', size - offset - 1);
+        size_t skip = next != NULL ? static_cast<const unsigned char*>(next) - data - offset : size - offset;
+        damaged += skip;
+        offset += skip;
+    }
+    damaged += size - offset;
+}
+
+// Map a log and scan it
+static bool readLog(int fd, ScoreBoard& board, long& records, long& damaged) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) return false;
+    if (st.st_size == 0) return true;
+    void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) return false;
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+    scanLog(static_cast<const unsigned char*>(mapping), st.st_size, board, records, damaged);
+    munmap(mapping, st.st_size);
+    return true;
+}
+
+ScoreLog::ScoreLog() : fd(-1), records(0), damaged(0) {
+}
+
+ScoreLog::~ScoreLog() {
+    close();
+}
+
+bool ScoreLog::open(const char* path) {
+    close();
+    this->path = path;
+    fd = ::open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    scores = ScoreBoard();
+    records = 0;
+    damaged = 0;
+
+    // A shared lock keeps a compaction from swapping the file mid-read
+    flock(fd, LOCK_SH);
+    reopenIfReplaced();
+    bool ok = readLog(fd, scores, records, damaged);
+    flock(fd, LOCK_UN);
+    if (!ok) close();
+    return ok;
+}
+
+void ScoreLog::close() {
+    if (compactor.joinable()) {
+        compactor.join();
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// With the shared lock held, make sure fd is still the file at path: a
+// compaction that finished while we waited for the lock renamed a new one
+// over it. Keeps the lock held on whatever fd ends up being.
+bool ScoreLog::reopenIfReplaced() {
+    for (;;) {
+        struct stat opened, named;
+        if (fstat(fd, &opened) < 0) return false;
+        if (stat(path.c_str(), &named) == 0 && named.st_ino == opened.st_ino && named.st_dev == opened.st_dev) {
+            return true;
+        }
+        int newFd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (newFd < 0) return false;
+        ::close(fd); // Drops the old file's lock
+        fd = newFd;
+        flock(fd, LOCK_SH);
+    }
+}
+
+bool ScoreLog::append(const ScoreRecord& record) {
+    if (fd < 0) return false;
+    ScoreRecord sealed = record;
+    sealScoreRecord(sealed);
+
+    // O_APPEND makes each write land whole at the end, even with other
+    // processes appending; the lock only keeps out a compaction
+    flock(fd, LOCK_SH);
+    bool ok = reopenIfReplaced() &&
+              write(fd, &sealed, sizeof(sealed)) == (ssize_t)sizeof(sealed) &&
+              fdatasync(fd) == 0;
+    flock(fd, LOCK_UN);
+    if (ok) {
+        scores.add(sealed);
+        ++records;
+    }
+    return ok;
+}
+
+void ScoreLog::compactInBackground() {
+    if (fd < 0 || compactor.joinable()) return;
+    compactor = std::thread(&ScoreLog::compact, this);
+}
+
+bool ScoreLog::compact() {
+    // Lock the log for ourselves; appenders wait, then find the new file
+    int logFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (logFd < 0) return false;
+    flock(logFd, LOCK_EX);
+    struct stat opened, named;
+    if (fstat(logFd, &opened) < 0 || stat(path.c_str(), &named) < 0 ||
+        named.st_ino != opened.st_ino || named.st_dev != opened.st_dev) {
+        ::close(logFd); // Someone else compacted it already
+        return true;
+    }
+
+    // Read it again, including whatever other processes added since open()
+    ScoreBoard board;
+    long count = 0, skipped = 0;
+    bool ok = readLog(logFd, board, count, skipped);
+    std::vector<ScoreRecord> kept;
+    board.all(kept);
+
+    // Write the leaderboard to a new file and rename it over the log
+    char tmpPath[4096];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.%d.tmp", path.c_str(), (int)getpid());
+    int tmpFd = ok ? ::open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    ok = tmpFd >= 0;
+    if (ok && !kept.empty()) {
+        ok = write(tmpFd, &kept[0], kept.size() * sizeof(ScoreRecord)) == (ssize_t)(kept.size() * sizeof(ScoreRecord));
+    }
+    if (tmpFd >= 0) {
+        ok = fsync(tmpFd) == 0 && ok;
+        ok = ::close(tmpFd) == 0 && ok;
+    }
+    if (ok) {
+        ok = rename(tmpPath, path.c_str()) == 0;
+    }
+    if (!ok) {
+        unlink(tmpPath);
+    } else {
+        // Make the rename itself survive a crash
+        std::string dir = path.substr(0, path.rfind('/') == std::string::npos ? 0 : path.rfind('/') + 1);
+        int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            ::close(dirFd);
+        }
+    }
+    ::close(logFd); // Releases the lock
+    return ok;
+}
@@ -0,0 +1,95 @@
+#ifndef SCORELOG_H
+#define SCORELOG_H
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// High-score log layout: nothing but ScoreRecords, appended one write() at
+// a time (native byte order). Each record starts with a marker and carries
+// a checksum, so a record torn by a crash is skipped when reading and the
+// records after it are still found.
+
+struct ScoreRecord {
+    char magic[4];            // "SKS1"
+    uint32_t checksum;        // Of everything after this field
+    int32_t score;
+    int32_t length;           // Snake length at the end of the game
+    uint8_t difficulty;       // 1-9
+    uint8_t walls;            // 1 if the walls were on
+    uint16_t reserved;
+    uint32_t rules;           // Rule set the game was played with
+    uint32_t durationMillis;  // How long the game lasted
+    uint32_t reserved2;
+    uint64_t seed;
+    int64_t playedAt;         // Unix time the game ended
+};
+
+// Leaderboard entries kept per (difficulty, walls)
+const int SCORE_TOP_K = 10;
+
+// The log is rewritten with only the leaderboard once it holds this many records
+const long SCORE_COMPACT_RECORDS = 65536;
+
+// Fill in the marker and checksum of a record
+void sealScoreRecord(ScoreRecord& record);
+
+// The best scores of each (difficulty, walls), as min-heaps of SCORE_TOP_K
+class ScoreBoard {
+public:
+    ScoreBoard();
+
+    void add(const ScoreRecord& record);
+
+    // Best scores first
+    void top(int difficulty, bool walls, std::vector<ScoreRecord>& out) const;
+
+    // Every record on the board
+    void all(std::vector<ScoreRecord>& out) const;
+
+private:
+    static const int BUCKETS = 9 * 2;
+    static int bucketOf(int difficulty, bool walls);
+
+    std::vector<ScoreRecord> heaps[BUCKETS];
+};
+
+// An append-only high-score log shared by every game process
+class ScoreLog {
+public:
+    ScoreLog();
+    ~ScoreLog();
+
+    // Create the log if needed and read it into the board
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // Add a game's result to the log and the board
+    bool append(const ScoreRecord& record);
+
+    const ScoreBoard& board() const { return scores; }
+    long recordCount() const { return records; }
+    long damagedBytes() const { return damaged; }
+
+    // Rewrite the log with only the leaderboard, if it has grown enough.
+    // The work happens on a background thread; close() waits for it.
+    bool needsCompaction() const { return records >= SCORE_COMPACT_RECORDS; }
+    void compactInBackground();
+
+    // Rewrite the log now. Safe while other processes append.
+    bool compact();
+
+private:
+    bool reopenIfReplaced();
+
+    std::string path;
+    int fd;
+    ScoreBoard scores;
+    long records;
+    long damaged;
+    std::thread compactor;
+};
+
+#endif
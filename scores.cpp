@@ -0,0 +1,110 @@
+// High-score log tool: prints the leaderboards in a log, compacts it, or
+// fills it with random results to time how fast a big log opens.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "scorelog.h"
+#include "timing.h"
+
+// Append count random results in one go, as a stand-in for years of games
+static bool fillLog(const char* path, long count) {
+    FILE* out = fopen(path, "ab");
+    if (out == NULL) return false;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (long i = 0; i < count; ++i) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        uint64_t r = state * 0x2545f4914f6cdd1dULL;
+        ScoreRecord record;
+        memset(&record, 0, sizeof(record));
+        record.score = (r >> 40) % 5000;
+        record.length = 4 + record.score / 10;
+        record.difficulty = 1 + (r >> 8) % 9;
+        record.walls = (r >> 20) & 1;
+        record.durationMillis = (r >> 24) % 600000;
+        record.seed = r;
+        record.playedAt = time(NULL);
+        sealScoreRecord(record);
+        fwrite(&record, sizeof(record), 1, out);
+    }
+    return fclose(out) == 0;
+}
+
+// Print one leaderboard
+static void printBoard(const ScoreBoard& board, int difficulty, bool walls) {
+    std::vector<ScoreRecord> best;
+    board.top(difficulty, walls, best);
+    if (best.empty()) return;
+    printf("Difficulty %d, walls %s\n", difficulty, walls ? "on" : "off");
+    for (size_t i = 0; i < best.size(); ++i) {
+        const ScoreRecord& r = best[i];
+        printf("  %2zu. %6d  length %4d  %6.1f s  seed %llu\n", i + 1, r.score, r.length,
+               r.durationMillis / 1000.0, (unsigned long long)r.seed);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    int difficulty = 0;
+    int walls = -1;
+    bool compact = false;
+    long fill = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && i + 1 < argc) {
+            walls = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        } else if (strcmp(argv[i], "--fill") == 0 && i + 1 < argc) {
+            fill = atol(argv[++i]);
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s SCORES [--difficulty 1-9] [--walls y|n] [--compact] [--fill N]\n", argv[0]);
+        return 1;
+    }
+
+    if (fill > 0 && !fillLog(path, fill)) {
+        perror(path);
+        return 1;
+    }
+
+    ScoreLog log;
+    struct timespec start = monotonicNow();
+    if (!log.open(path)) {
+        perror(path);
+        return 1;
+    }
+    double seconds = secondsSince(start);
+    printf("%s: %ld records, %ld damaged bytes skipped, read in %.1f ms\n",
+           path, log.recordCount(), log.damagedBytes(), seconds * 1000);
+
+    for (int d = 1; d <= 9; ++d) {
+        if (difficulty != 0 && d != difficulty) continue;
+        for (int w = 0; w <= 1; ++w) {
+            if (walls >= 0 && w != walls) continue;
+            printBoard(log.board(), d, w != 0);
+        }
+    }
+
+    if (compact) {
+        start = monotonicNow();
+        if (!log.compact()) {
+            fprintf(stderr, "%s: compaction failed\n", path);
+            return 1;
+        }
+        printf("Compacted in %.1f ms\n", secondsSince(start) * 1000);
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * Plugin interface for bots built as shared libraries. Plain C, so a bot
+ * can be written in anything that produces a C-compatible .so:
+ *
+ *   cc -O2 -shared -fPIC -o mybot.so mybot.c
+ *   ./snake2 --bot ./mybot.so
+ *
+ * A plugin exports snake_bot_abi(), returning SNAKE_BOT_ABI, and decide().
+ * It may also export snake_bot_reset(), called before each game. One
+ * library can be loaded by several threads at once (the tournament does
+ * this), so keep state per game out of globals or guard it.
+ */
+#ifndef SNAKEBOT_H
+#define SNAKEBOT_H
+
+#include <stdint.h>
+
+#define SNAKE_BOT_ABI 1
+
+/* Tile values in cells; positive values are the snake's body */
+#define SNAKE_EMPTY 0
+#define SNAKE_FOOD (-2)
+#define SNAKE_WALL (-3)
+/* Food worth v > 1 helpings is stored as SNAKE_FOOD_VALUE_BASE - v */
+#define SNAKE_FOOD_VALUE_BASE (-10)
+
+/* Keys decide() can return */
+#define SNAKE_UP 'w'
+#define SNAKE_RIGHT 'd'
+#define SNAKE_DOWN 's'
+#define SNAKE_LEFT 'a'
+#define SNAKE_STRAIGHT (-1)
+
+/* The game as a bot sees it. cells points straight at the game's board
+ * and is only valid during the call. */
+typedef struct SnakeView {
+    const int32_t* cells;  /* width * height tiles, row by row */
+    int32_t width;
+    int32_t height;
+    int32_t headx;
+    int32_t heady;
+    int32_t direction;     /* 0 up, 1 right, 2 down, 3 left */
+    int32_t food;          /* Snake length; the head's cell holds this value */
+    int32_t score;
+    int32_t wraps;         /* Leaving the map comes back on the other side */
+    int64_t tick;
+} SnakeView;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int (*SnakeBotAbiFunction)(void);
+typedef int (*SnakeBotDecideFunction)(const SnakeView* view);
+typedef void (*SnakeBotResetFunction)(uint64_t seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,521 @@
+// Exhaustive solver for small boards: the most food a perfect player can
+// expect to eat within a number of moves, under a rule set's walls and
+// collisions. The player picks every move; where the next piece of food
+// appears is up to chance, every empty cell being as likely (as in
+// generateFood()), so the value of a position is the best move's value
+// and the value of eating is one plus the average over where the next
+// piece can appear (expectimax). The first piece is placed by chance too.
+//
+//   ./solver --size 6x6 --rules snake2 --depth 40 --memory 512
+//
+// Boards of up to 64 cells (8x8) fit in the encoding. With walls on, the
+// edges are walls, so 6x6 leaves 4x4 to move in, as in the game. Searching
+// every line of play grows quickly with the depth: whole games are only
+// within reach on the smallest boards.
+//
+// A position is encoded in 192 bits: the cells of the body as a chain of
+// 2-bit steps from the head, the head, the food, the length, the cells the
+// body covers so far and the direction. Positions reached in more than
+// one way are looked up in a transposition table shared by every thread
+// without locks: each entry is stored as the key XORed with the value,
+// and the value, so a read that races with a write doesn't match.
+// --check N plays N random games through the engine and the solver's
+// moves side by side and compares them tick by tick.
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "timing.h"
+#include "variants.h"
+
+using namespace std;
+
+const int MAX_CELLS = 64;
+const int NO_FOOD = 127;
+
+// Settings
+int boardWidth = 6;
+int boardHeight = 6;
+int depthLimit = 30;        // Moves looked ahead
+long memoryMegabytes = 256; // Transposition table
+int threads = 0;            // 0 = one per core
+int difficulty = 5;
+bool wallsEnabled = true;
+long checkGames = 0;        // Games to check against the engine, instead of solving
+
+// The board: which cells are walls and where a move from each cell leads
+struct Board {
+    int width;
+    int height;
+    int cells;
+    uint64_t walls;        // Bit per cell
+    uint64_t all;          // Every cell of the board
+    int open;              // Cells that aren't walls
+    int next[MAX_CELLS][4]; // Cell a move leads to, -1 off the edge
+};
+Board board;
+
+// A position, with the body both as a ring of cells (for moving) and as a
+// mask (for collisions)
+struct Position {
+    uint64_t path[2];      // Step from each body cell to the next towards the tail, 2 bits each, head first
+    uint64_t covered;      // Cells of the body
+    int head;
+    int food;              // NO_FOOD if none is left
+    int length;            // The head's value, see engine.h
+    int occupied;          // Cells the body covers, at most length
+    int direction;
+    int front;             // Head's place in ring
+    uint8_t ring[MAX_CELLS];
+
+    int tail() const { return ring[(front + occupied - 1) & (MAX_CELLS - 1)]; }
+
+    // Move the head to cell, going in direction d, eating if the food is there
+    void move(int cell, int d) {
+        bool ate = cell == food;
+        if (!ate && occupied == length) {
+            covered &= ~(1ULL << tail()); // The tail's cell counts down to 0
+            --occupied;
+        }
+        front = (front - 1) & (MAX_CELLS - 1);
+        ring[front] = cell;
+        covered |= 1ULL << cell;
+        ++occupied;
+        if (ate) {
+            ++length;
+            food = NO_FOOD;
+        }
+        head = cell;
+        direction = d;
+
+        // The step from the new head back to the old one, then forget steps past the tail
+        path[1] = path[1] << 2 | path[0] >> 62;
+        path[0] = path[0] << 2 | ((d + 2) & 3);
+        int bits = 2 * (occupied - 1);
+        if (bits < 64) {
+            path[0] &= bits == 0 ? 0 : ~0ULL >> (64 - bits);
+            path[1] = 0;
+        } else {
+            path[1] &= bits == 64 ? 0 : ~0ULL >> (128 - bits);
+        }
+    }
+};
+
+// The encoding looked up in the table
+struct Key {
+    uint64_t words[3];
+};
+
+static Key keyOf(const Position& p) {
+    Key key;
+    key.words[0] = p.path[0];
+    key.words[1] = p.path[1];
+    key.words[2] = (uint64_t)p.head | (uint64_t)p.food << 7 | (uint64_t)p.length << 14 |
+                   (uint64_t)p.occupied << 21 | (uint64_t)p.direction << 28;
+    return key;
+}
+
+// Transposition table: buckets of two entries in one cache line. The
+// first entry keeps the deepest search, the second the latest.
+struct Entry {
+    atomic<uint64_t> words[4]; // The key's words XORed with data, then data
+};
+
+struct Bucket {
+    Entry entries[2];
+};
+
+// data: the value's float bits, the depth searched (never 0, so an empty
+// entry never matches) and whether the search saw every game to its end,
+// so the value holds at any greater depth too
+static uint64_t packData(float value, int depth, bool complete) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (uint64_t)complete << 48 | (uint64_t)depth << 32 | bits;
+}
+
+class Table {
+public:
+    Table() : buckets(NULL), mask(0) {}
+    ~Table() { free(buckets); }
+
+    // The largest power of two of buckets that fits in the budget
+    void allocate(long megabytes) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Bucket) <= (size_t)megabytes << 20) count *= 2;
+        void* memory = NULL;
+        if (posix_memalign(&memory, 64, count * sizeof(Bucket)) != 0) abort();
+        memset(memory, 0, count * sizeof(Bucket));
+        buckets = static_cast<Bucket*>(memory);
+        mask = count - 1;
+    }
+
+    size_t bucketCount() const { return mask + 1; }
+
+    bool probe(const Key& key, int depth, float& value, bool& complete) const {
+        const Bucket& bucket = buckets[indexOf(key)];
+        for (int e = 0; e < 2; ++e) {
+            const Entry& entry = bucket.entries[e];
+            uint64_t data = entry.words[3].load(memory_order_relaxed);
+            int stored = (data >> 32) & 0xffff;
+            if (stored == 0 || (stored != depth && !((data >> 48) && depth > stored))) continue;
+            if ((entry.words[0].load(memory_order_relaxed) ^ data) == key.words[0] &&
+                (entry.words[1].load(memory_order_relaxed) ^ data) == key.words[1] &&
+                (entry.words[2].load(memory_order_relaxed) ^ data) == key.words[2]) {
+                uint32_t bits = (uint32_t)data;
+                memcpy(&value, &bits, sizeof(value));
+                complete = data >> 48;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(const Key& key, int depth, bool complete, float value) {
+        Bucket& bucket = buckets[indexOf(key)];
+        uint64_t data = packData(value, depth, complete);
+        Entry& deepest = bucket.entries[0];
+        int stored = (deepest.words[3].load(memory_order_relaxed) >> 32) & 0xffff;
+        Entry& entry = stored <= depth ? deepest : bucket.entries[1];
+        entry.words[0].store(key.words[0] ^ data, memory_order_relaxed);
+        entry.words[1].store(key.words[1] ^ data, memory_order_relaxed);
+        entry.words[2].store(key.words[2] ^ data, memory_order_relaxed);
+        entry.words[3].store(data, memory_order_relaxed);
+    }
+
+private:
+    size_t indexOf(const Key& key) const {
+        uint64_t x = key.words[0] * 0x9e3779b97f4a7c15ULL ^ key.words[1] * 0xc2b2ae3d27d4eb4fULL ^
+                     key.words[2] * 0x165667b19e3779f9ULL;
+        x ^= x >> 29;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 32;
+        return x & mask;
+    }
+
+    Bucket* buckets;
+    size_t mask;
+};
+Table table;
+
+// One thread's search, with its own counters
+struct Searcher {
+    long nodes;
+    long probes;
+    long hits;
+    bool horizon;          // The search so far stopped some game at the depth limit
+
+    Searcher() : nodes(0), probes(0), hits(0), horizon(false) {}
+
+    // Most food to expect from a position in depth moves, the food placed
+    float best(const Position& p, int depth) {
+        if (p.food == NO_FOOD) return 0;
+        if (depth == 0) {
+            horizon = true;
+            return 0;
+        }
+        ++nodes;
+        Key key = keyOf(p);
+        float value;
+        bool complete;
+        ++probes;
+        if (table.probe(key, depth, value, complete)) {
+            ++hits;
+            // A value that holds only at this depth stops at the horizon somewhere
+            if (!complete) horizon = true;
+            return value;
+        }
+
+        // No more food can be eaten than there are moves, or cells left
+        // for the body to grow into: stop at the first move that gets it.
+        // The move onto the food goes first.
+        int cellsLeft = board.open - p.occupied;
+        int most = depth < cellsLeft ? depth : cellsLeft;
+        bool outer = horizon;
+        horizon = false;
+        value = 0;
+        for (int i = 0; i < 4 && value < most; ++i) {
+            int d = (foodDirection(p) + i) & 3;
+            float v = afterMove(p, d, depth);
+            if (v > value) value = v;
+        }
+        complete = value >= cellsLeft || (!horizon && value < most);
+        table.store(key, depth, complete, value);
+        horizon = outer || !complete;
+        return value;
+    }
+
+    // A direction that leads onto the food if one does, else up
+    static int foodDirection(const Position& p) {
+        for (int d = 0; d < 4; ++d) {
+            if (board.next[p.head][d] == p.food) return d;
+        }
+        return 0;
+    }
+
+    // Value of taking direction d; a move that crashes is worth nothing more
+    float afterMove(const Position& p, int d, int depth) {
+        if (d == ((p.direction + 2) & 3)) return 0; // Can't turn back on itself
+        int cell = board.next[p.head][d];
+        if (cell < 0 || ((board.walls | p.covered) >> cell & 1)) return 0;
+        Position child = p;
+        child.move(cell, d);
+        if (child.food != NO_FOOD) return best(child, depth - 1);
+        return 1 + spawn(child, depth - 1);
+    }
+
+    // Food was eaten: the next piece goes on any empty cell, each as likely
+    float spawn(Position& p, int depth) {
+        uint64_t empty = board.all & ~(board.walls | p.covered);
+        if (empty == 0) return 0; // The snake fills the board
+        if (depth == 0) {
+            horizon = true;
+            return 0;
+        }
+        double sum = 0;
+        int count = 0;
+        for (uint64_t left = empty; left != 0; left &= left - 1) {
+            p.food = __builtin_ctzll(left);
+            sum += best(p, depth);
+            ++count;
+        }
+        p.food = NO_FOOD;
+        return sum / count;
+    }
+};
+
+// The position a new game starts in, without its food
+template <class Engine>
+Position startPosition(Engine& game) {
+    game.resize(boardWidth, boardHeight);
+    game.difficulty = difficulty;
+    game.wallsEnabled = wallsEnabled;
+    game.seed(1);
+    game.initMap();
+
+    board.width = boardWidth;
+    board.height = boardHeight;
+    board.cells = game.mapSize;
+    board.all = board.cells == 64 ? ~0ULL : (1ULL << board.cells) - 1;
+    board.walls = 0;
+    board.open = 0;
+    static const int dx[4] = {0, 1, 0, -1};
+    static const int dy[4] = {-1, 0, 1, 0};
+    for (int c = 0; c < board.cells; ++c) {
+        if (game.map[c] == WALL) board.walls |= 1ULL << c;
+        else ++board.open;
+        for (int d = 0; d < 4; ++d) {
+            int x = c % boardWidth + dx[d];
+            int y = c / boardWidth + dy[d];
+            board.next[c][d] = Engine::Walls::enter(game, x, y) ? y * boardWidth + x : -1;
+        }
+    }
+
+    Position p;
+    memset(&p, 0, sizeof(p));
+    p.head = game.headypos * boardWidth + game.headxpos;
+    p.food = NO_FOOD;
+    p.length = game.food;
+    p.occupied = 1;
+    p.direction = game.direction;
+    p.front = 0;
+    p.ring[0] = p.head;
+    p.covered = 1ULL << p.head;
+    return p;
+}
+
+// Play random games through the engine and through Position::move() and
+// compare them after every tick. Moves mostly avoid crashing, so bodies
+// grow long, but now and then one is made blindly to test crashes too. Returns the number of ticks that differ.
+template <class Engine>
+long checkAgainstEngine() {
+    static const char keys[4] = {'w', 'd', 's', 'a'};
+    long ticks = 0, differences = 0;
+    uint64_t random = 0x2545f4914f6cdd1dULL;
+    for (long g = 0; g < checkGames; ++g) {
+        Engine game;
+        Position p = startPosition(game);
+        game.seed(g + 1);
+        game.initMap();
+        p.food = game.lastFoodCell >= 0 ? game.lastFoodCell : NO_FOOD;
+        game.running = true;
+        for (int t = 0; game.running && t < 10000; ++t) {
+            random ^= random >> 12;
+            random ^= random << 25;
+            random ^= random >> 27;
+            uint64_t r = random * 0x2545f4914f6cdd1dULL;
+            int d = r >> 62;
+
+            // Mostly keep clear of crashes, so the snake grows long
+            if ((r & 15) != 0) {
+                for (int i = 0; i < 4; ++i) {
+                    int cell = board.next[p.head][(d + i) & 3];
+                    if (((d + i) & 3) != ((p.direction + 2) & 3) && cell >= 0 &&
+                        !((board.walls | p.covered) >> cell & 1)) {
+                        d = (d + i) & 3;
+                        break;
+                    }
+                }
+            }
+            game.changeDirection(keys[d]);
+            d = game.direction;
+            game.update();
+            ++ticks;
+            int cell = board.next[p.head][d];
+            bool crashes = cell < 0 || ((board.walls | p.covered) >> cell & 1);
+            if (crashes != !game.running) {
+                ++differences;
+                break;
+            }
+            if (crashes) break;
+            bool ate = cell == p.food;
+            p.move(cell, d);
+            if (ate) p.food = game.lastFoodCell >= 0 ? game.lastFoodCell : NO_FOOD;
+
+            // Every body cell holds its value in the engine's map
+            bool same = p.head == game.headypos * boardWidth + game.headxpos && p.length == game.food;
+            uint64_t covered = 0;
+            for (int c = 0; c < board.cells; ++c) {
+                if (game.map[c] > 0) covered |= 1ULL << c;
+            }
+            same = same && covered == p.covered;
+            int cellAt = p.head;
+            for (int i = 0; same && i < p.occupied; ++i) {
+                same = game.map[cellAt] == p.length - i;
+                if (i + 1 < p.occupied) {
+                    int step = (i < 32 ? p.path[0] >> (2 * i) : p.path[1] >> (2 * i - 64)) & 3;
+                    cellAt = board.next[cellAt][step];
+                    same = same && cellAt >= 0;
+                }
+            }
+            if (!same) {
+                ++differences;
+                break;
+            }
+        }
+    }
+    printf("Checked %ld games, %ld ticks against the engine: %ld differences\n", checkGames, ticks, differences);
+    return differences;
+}
+
+// Worker thread: take (first food, first move) pairs until there are none left
+void solveJobs(const Position& start, const vector<int>& foods, int depth, atomic<long>& nextJob,
+               vector<float>& values, Searcher& searcher) {
+    long jobs = foods.size() * 4;
+    for (long job = nextJob++; job < jobs; job = nextJob++) {
+        Position p = start;
+        p.food = foods[job / 4];
+        values[job] = searcher.afterMove(p, job % 4, depth);
+    }
+}
+
+template <class Engine>
+int solve() {
+    Engine game;
+    Position start = startPosition(game);
+    if (checkGames > 0) {
+        return checkAgainstEngine<Engine>() == 0 ? 0 : 1;
+    }
+
+    // The first piece of food goes on any empty cell
+    vector<int> foods;
+    for (int c = 0; c < board.cells; ++c) {
+        if (!((board.walls | start.covered) >> c & 1)) foods.push_back(c);
+    }
+    table.allocate(memoryMegabytes);
+    printf("Board %dx%d, %d open cells, depth %d, %zu MB table (%zu buckets), %d threads\n",
+           boardWidth, boardHeight, (int)foods.size() + 1, depthLimit,
+           table.bucketCount() * sizeof(Bucket) >> 20, table.bucketCount(), threads);
+
+    vector<float> values(foods.size() * 4);
+    vector<Searcher> searchers(threads);
+    atomic<long> nextJob(0);
+    struct timespec startTime = monotonicNow();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(thread(solveJobs, cref(start), cref(foods), depthLimit, ref(nextJob),
+                                 ref(values), ref(searchers[t])));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    double seconds = secondsSince(startTime);
+
+    double total = 0;
+    for (size_t f = 0; f < foods.size(); ++f) {
+        float value = 0;
+        for (int d = 0; d < 4; ++d) {
+            if (values[f * 4 + d] > value) value = values[f * 4 + d];
+        }
+        total += value;
+    }
+    double expected = total / foods.size();
+    long nodes = 0, probes = 0, hits = 0;
+    for (int t = 0; t < threads; ++t) {
+        nodes += searchers[t].nodes;
+        probes += searchers[t].probes;
+        hits += searchers[t].hits;
+    }
+    printf("Best play eats %.3f food on average within %d moves: a score of %.2f\n",
+           expected, depthLimit, expected * Engine::Scoring::points(game));
+    printf("%ld nodes in %.2f s: %.2f M nodes/s, table hits %.1f%% of %ld probes\n",
+           nodes, seconds, nodes / seconds / 1e6, probes > 0 ? 100.0 * hits / probes : 0.0, probes);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rules = "snake2";
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            ok = sscanf(argv[++i], "%dx%d", &boardWidth, &boardHeight) == 2 && boardWidth >= 3 &&
+                 boardHeight >= 3 && boardWidth * boardHeight <= MAX_CELLS;
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depthLimit = atoi(argv[++i]);
+            ok = depthLimit >= 1 && depthLimit < 65536;
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            memoryMegabytes = atol(argv[++i]);
+            ok = memoryMegabytes >= 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules = argv[++i];
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && i + 1 < argc) {
+            wallsEnabled = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+            checkGames = atol(argv[++i]);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Usage: %s [--size WxH (at most 64 cells)] [--depth MOVES] [--memory MB] [--threads N]\n"
+                        "       [--rules snake2..snake7] [--difficulty 1-9] [--walls y|n] [--check GAMES]\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) {
+        threads = thread::hardware_concurrency();
+        if (threads < 1) threads = 1;
+    }
+
+    printf("Rules %s, walls %s\n", rules, wallsEnabled ? "on" : "off");
+    if (strcmp(rules, "snake") == 0) {
+        fprintf(stderr, "Under snake's rules a crash only pauses the snake, so games never end\n");
+        return 1;
+    }
+    if (strcmp(rules, "snake2") == 0) return solve<Snake2Engine>();
+    if (strcmp(rules, "snake3") == 0) return solve<Snake3Engine>();
+    if (strcmp(rules, "snake4") == 0) return solve<Snake4Engine>();
+    if (strcmp(rules, "snake5") == 0) return solve<Snake5Engine>();
+    if (strcmp(rules, "snake6") == 0) return solve<Snake6Engine>();
+    if (strcmp(rules, "snake7") == 0) return solve<Snake7Engine>();
+    fprintf(stderr, "Unknown rules: %s\n", rules);
+    return 1;
+}
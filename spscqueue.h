@@ -0,0 +1,38 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size lock-free queue for one producer thread and one consumer thread.
+// Capacity must be a power of two. push() fails instead of waiting when full.
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    bool push(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head; // Next item to pop (consumer)
+    alignas(64) std::atomic<size_t> tail; // Next free slot (producer)
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <ctime>
+
+// Current time on the monotonic clock
+inline struct timespec monotonicNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now;
+}
+
+// Seconds elapsed on the monotonic clock since start
+inline double secondsSince(const struct timespec& start) {
+    struct timespec now = monotonicNow();
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// CPU time used by the calling thread, in nanoseconds
+inline long threadCpuNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+#endif
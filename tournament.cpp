@@ -0,0 +1,293 @@
+// Tournament: plays every bot on every seed in a range, headless and in
+// parallel, and compares them. Every bot plays the same seeds, so the
+// differences between bots are measured game by game (paired) rather than
+// only between averages.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bots.h"
+#include "timing.h"
+#include "variants.h"
+
+using namespace std;
+
+// How a game ended
+const int END_TIME_LIMIT = 4; // After COLLIDE_NONE..COLLIDE_BODY
+const int END_CAUSES = 5;
+const char* causeNames[END_CAUSES] = {"none", "edge", "wall", "body", "time"};
+
+// Outcome of one (bot, seed) game
+struct GameResult {
+    int score;
+    int length;
+    long ticks;
+    int cause;
+    long cpuNanos;
+};
+
+// Tournament settings
+vector<string> botList;
+long firstSeed = 1;
+long lastSeed = 1000;
+int threads = 0;            // 0 = one per core
+long maxTicks = 20000;      // Tick limit per game
+int difficulty = 5;
+bool wallsEnabled = true;
+int mapWidth = 0;           // 0 = default size
+int mapHeight = 0;
+int foodItems = 1;
+long deadlineMicros = 0;    // Per-move deadline for every bot (0 = none)
+long cacheEntries = 0;      // Decisions each bot remembers by position (0 = none)
+
+// Decision timings of each bot, summed over the threads
+vector<BotStats> botStats;
+mutex statsLock;
+
+// Play one game with a bot
+template <class Engine>
+GameResult playGame(Bot& bot, uint64_t seed) {
+    long cpuStart = threadCpuNanos();
+    Engine game;
+    if (mapWidth > 0) {
+        game.resize(mapWidth, mapHeight);
+    }
+    game.foodItems = foodItems;
+    game.seed(seed);
+    game.difficulty = difficulty;
+    game.wallsEnabled = wallsEnabled;
+    game.initMap();
+    game.running = true;
+    bot.reset(seed);
+
+    GameResult result;
+    result.ticks = 0;
+    while (game.running && result.ticks < maxTicks) {
+        int ch = bot.play(game, Engine::Walls::wraps);
+        if (ch != NO_KEY) {
+            game.changeDirection(ch);
+        }
+        game.update();
+        ++result.ticks;
+    }
+    result.score = game.score;
+    result.length = game.food;
+    result.cause = game.running ? END_TIME_LIMIT : game.collision;
+    result.cpuNanos = threadCpuNanos() - cpuStart;
+    return result;
+}
+
+// Worker thread: take (bot, seed) pairs until there are none left
+template <class Engine>
+void playGames(atomic<long>& nextJob, vector<vector<GameResult> >& results) {
+    long seeds = lastSeed - firstSeed + 1;
+    long jobs = seeds * botList.size();
+    vector<Bot*> bots;
+    for (size_t b = 0; b < botList.size(); ++b) {
+        bots.push_back(createBot(botList[b].c_str()));
+        bots[b]->deadlineNanos = deadlineMicros * 1000L;
+        bots[b]->useCache(cacheEntries);
+    }
+    for (long job = nextJob++; job < jobs; job = nextJob++) {
+        // Seed-major order, so every bot progresses together
+        long seed = job / botList.size();
+        int b = job % botList.size();
+        results[b][seed] = playGame<Engine>(*bots[b], firstSeed + seed);
+    }
+    lock_guard<mutex> lock(statsLock);
+    for (size_t b = 0; b < bots.size(); ++b) {
+        BotStats& total = botStats[b];
+        total.calls += bots[b]->stats.calls;
+        total.nanos += bots[b]->stats.nanos;
+        total.late += bots[b]->stats.late;
+        total.cached += bots[b]->stats.cached;
+        if (bots[b]->stats.maxNanos > total.maxNanos) total.maxNanos = bots[b]->stats.maxNanos;
+        delete bots[b];
+    }
+}
+
+// Mean and the half-width of its 95% confidence interval
+static void meanInterval(const vector<double>& values, double& mean, double& halfWidth) {
+    double n = values.size();
+    double sum = 0;
+    for (size_t i = 0; i < values.size(); ++i) sum += values[i];
+    mean = sum / n;
+    double squares = 0;
+    for (size_t i = 0; i < values.size(); ++i) squares += (values[i] - mean) * (values[i] - mean);
+    halfWidth = n > 1 ? 1.96 * sqrt(squares / (n - 1) / n) : 0;
+}
+
+// Print every bot's statistics, then each bot against the first one
+static void report(const vector<vector<GameResult> >& results, double seconds) {
+    long seeds = lastSeed - firstSeed + 1;
+    long totalTicks = 0;
+    printf("%-10s %10s %14s %8s %8s %12s   %s\n",
+           "bot", "mean", "95% CI", "median", "length", "steps/s", "ends");
+    for (size_t b = 0; b < results.size(); ++b) {
+        vector<double> scores(seeds);
+        long ticks = 0, cpuNanos = 0, length = 0;
+        long causes[END_CAUSES] = {0, 0, 0, 0, 0};
+        for (long s = 0; s < seeds; ++s) {
+            const GameResult& r = results[b][s];
+            scores[s] = r.score;
+            ticks += r.ticks;
+            cpuNanos += r.cpuNanos;
+            length += r.length;
+            causes[r.cause]++;
+        }
+        totalTicks += ticks;
+        double mean, halfWidth;
+        meanInterval(scores, mean, halfWidth);
+        sort(scores.begin(), scores.end());
+        double median = seeds % 2 ? scores[seeds / 2] : (scores[seeds / 2 - 1] + scores[seeds / 2]) / 2;
+        printf("%-10s %10.1f %6.1f-%-7.1f %8.1f %8.1f %12.0f   ",
+               botList[b].c_str(), mean, mean - halfWidth, mean + halfWidth, median,
+               (double)length / seeds, ticks / (cpuNanos / 1e9));
+        for (int c = 0; c < END_CAUSES; ++c) {
+            printf(" %s %ld", causeNames[c], causes[c]);
+        }
+        printf("\n");
+    }
+
+    // What each decision cost
+    for (size_t b = 0; b < results.size(); ++b) {
+        const BotStats& st = botStats[b];
+        printf("%-10s decide %.0f ns average, %.1f us slowest, %ld of %ld late", botList[b].c_str(),
+               st.calls > 0 ? (double)st.nanos / st.calls : 0.0, st.maxNanos / 1000.0, st.late, st.calls);
+        if (cacheEntries > 0) {
+            printf(", %.1f%% from the cache", st.calls > 0 ? 100.0 * st.cached / st.calls : 0.0);
+        }
+        printf("\n");
+    }
+
+    // Paired differences against the first bot on the same seeds
+    for (size_t b = 1; b < results.size(); ++b) {
+        vector<double> differences(seeds);
+        long wins = 0, losses = 0;
+        for (long s = 0; s < seeds; ++s) {
+            differences[s] = results[b][s].score - results[0][s].score;
+            if (differences[s] > 0) ++wins;
+            if (differences[s] < 0) ++losses;
+        }
+        double mean, halfWidth;
+        meanInterval(differences, mean, halfWidth);
+        printf("%s - %s: %+.1f (95%% CI %+.1f to %+.1f), wins %ld, losses %ld, ties %ld\n",
+               botList[b].c_str(), botList[0].c_str(), mean, mean - halfWidth, mean + halfWidth,
+               wins, losses, seeds - wins - losses);
+    }
+    printf("%ld games, %ld steps in %.2f s on %d threads: %.0f steps/s\n",
+           seeds * (long)results.size(), totalTicks, seconds, threads, totalTicks / seconds);
+}
+
+// Run the whole tournament under one rule set
+template <class Engine>
+void runTournament() {
+    long seeds = lastSeed - firstSeed + 1;
+    vector<vector<GameResult> > results(botList.size(), vector<GameResult>(seeds));
+    BotStats zero = {0, 0, 0, 0, 0};
+    botStats.assign(botList.size(), zero);
+    atomic<long> nextJob(0);
+    struct timespec start = monotonicNow();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(thread(playGames<Engine>, ref(nextJob), ref(results)));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    report(results, secondsSince(start));
+}
+
+// Split a comma separated list
+static vector<string> splitList(const char* text) {
+    vector<string> items;
+    string item;
+    for (const char* p = text; ; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) items.push_back(item);
+            item.clear();
+            if (*p == '\0') break;
+        } else {
+            item += *p;
+        }
+    }
+    return items;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rules = "snake6";
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (strcmp(argv[i], "--bots") == 0 && i + 1 < argc) {
+            botList = splitList(argv[++i]);
+        } else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+            ok = sscanf(argv[++i], "%ld-%ld", &firstSeed, &lastSeed) == 2 && firstSeed <= lastSeed;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules = argv[++i];
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            difficulty = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--walls") == 0 && i + 1 < argc) {
+            wallsEnabled = argv[++i][0] == 'y';
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            ok = sscanf(argv[++i], "%dx%d", &mapWidth, &mapHeight) == 2 && mapWidth >= 3 && mapHeight >= 3;
+        } else if (strcmp(argv[i], "--deadline") == 0 && i + 1 < argc) {
+            deadlineMicros = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cacheEntries = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--food") == 0 && i + 1 < argc) {
+            foodItems = atoi(argv[++i]);
+            if (foodItems < 1) foodItems = 1;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Usage: %s [--bots A,B,...] [--seeds FIRST-LAST] [--threads N] [--rules snake|snake2..snake7]\n"
+                        "       [--ticks N] [--difficulty 1-9] [--walls y|n] [--size WxH] [--food N] [--deadline MICROS]\n"
+                        "       [--cache ENTRIES]\n"
+                        "Bots: %s\n", argv[0], botNames());
+        return 1;
+    }
+    if (botList.empty()) {
+        botList = splitList("greedy,flood,random");
+    }
+    for (size_t b = 0; b < botList.size(); ++b) {
+        Bot* bot = createBot(botList[b].c_str());
+        if (bot == NULL) {
+            fprintf(stderr, "Unknown bot: %s (have: %s)\n", botList[b].c_str(), botNames());
+            return 1;
+        }
+        delete bot;
+    }
+    if (threads < 1) {
+        threads = thread::hardware_concurrency();
+        if (threads < 1) threads = 1;
+    }
+
+    printf("Rules %s, seeds %ld-%ld, difficulty %d, walls %s\n",
+           rules, firstSeed, lastSeed, difficulty, wallsEnabled ? "on" : "off");
+    if (strcmp(rules, "snake") == 0) runTournament<SnakeEngine>();
+    else if (strcmp(rules, "snake2") == 0) runTournament<Snake2Engine>();
+    else if (strcmp(rules, "snake3") == 0) runTournament<Snake3Engine>();
+    else if (strcmp(rules, "snake4") == 0) runTournament<Snake4Engine>();
+    else if (strcmp(rules, "snake5") == 0) runTournament<Snake5Engine>();
+    else if (strcmp(rules, "snake6") == 0) runTournament<Snake6Engine>();
+    else if (strcmp(rules, "snake7") == 0) runTournament<Snake7Engine>();
+    else {
+        fprintf(stderr, "Unknown rules: %s\n", rules);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Lock-free hand-over of the latest value from one writer thread to one
+// reader thread. The writer never waits for the reader and the reader
+// always gets the newest complete value; values it didn't get to are skipped.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), front(0), back(2) {}
+
+    // Slot the writer fills before calling publish()
+    T& writeBuffer() { return slots[back]; }
+
+    // Make the filled slot the latest value
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Take the latest value if there is a new one. Returns false if not.
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // Slot the reader got from the last successful update()
+    const T& readBuffer() const { return slots[front]; }
+
+private:
+    static const int INDEX = 3; // Low bits: slot index
+    static const int FRESH = 4; // Set when the middle slot hasn't been read yet
+
+    T slots[3];
+    alignas(64) std::atomic<int> middle; // Slot being handed over
+    alignas(64) int front;               // Reader's slot
+    alignas(64) int back;                // Writer's slot
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef VARIANTS_H
+#define VARIANTS_H
+
+#include "engine.h"
+
+// The rule sets of each snake*.cpp iteration of the game
+
+// snake: fixed walls. Running into something doesn't end the game: the
+// snake stays still for one loop so the player can turn away.
+typedef Engine<FixedWalls, ForgiveCollision, FlatScoring, FixedSpeed> SnakeEngine;
+
+// snake2: fixed walls. Running into anything ends the game.
+typedef Engine<FixedWalls, DieOnCollision, FlatScoring, FixedSpeed> Snake2Engine;
+
+// snake3: a difficulty level sets the speed, and the walls can be turned
+// off. Leaving the map still ends the game.
+typedef Engine<OptionalWalls, DieOnCollision, FlatScoring, DifficultySpeed> Snake3Engine;
+
+// snake4: without walls the snake wraps around the screen.
+typedef Engine<WrapWalls, DieOnCollision, FlatScoring, DifficultySpeed> Snake4Engine;
+
+// snake5: same rules as snake4. This iteration fixed the difficulty and
+// walls questions not waiting for a key, which the driver now always does.
+typedef Snake4Engine Snake5Engine;
+
+// snake6: food is worth 10 times the difficulty level.
+typedef Engine<WrapWalls, DieOnCollision, DifficultyScoring, DifficultySpeed> Snake6Engine;
+
+// snake7: same rules as snake6. This iteration added the score line above
+// the board, which the renderers now always draw.
+typedef Snake6Engine Snake7Engine;
+
+#endif